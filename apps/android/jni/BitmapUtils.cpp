@@ -12,10 +12,9 @@ namespace bmp
         }
     }
 
-    jobject matToBitmap(JNIEnv *env, const cv::Mat &rgba)
+    // 빈 ARGB_8888 Bitmap 생성
+    static jobject createArgbBitmap(JNIEnv *env, int width, int height)
     {
-        // rgba: CV_8UC4 (R,G,B,A)
-        // Bitmap config ARGB_8888는 메모리상 BGRA가 일반적이니 채널 스왑 필요 여부 확인
         jclass bitmapCls = env->FindClass("android/graphics/Bitmap");
         jclass configCls = env->FindClass("android/graphics/Bitmap$Config");
         jmethodID valueOf = env->GetStaticMethodID(configCls, "valueOf", "(Ljava/lang/String;)Landroid/graphics/Bitmap$Config;");
@@ -24,8 +23,16 @@ namespace bmp
         env->DeleteLocalRef(argb);
 
         jmethodID create = env->GetStaticMethodID(bitmapCls, "createBitmap", "(IILandroid/graphics/Bitmap$Config;)Landroid/graphics/Bitmap;");
-        jobject bmp = env->CallStaticObjectMethod(bitmapCls, create, rgba.cols, rgba.rows, config);
+        jobject bmp = env->CallStaticObjectMethod(bitmapCls, create, width, height, config);
         env->DeleteLocalRef(config);
+        return bmp;
+    }
+
+    jobject matToBitmap(JNIEnv *env, const cv::Mat &rgba)
+    {
+        // rgba: CV_8UC4 (R,G,B,A)
+        // Bitmap config ARGB_8888는 메모리상 BGRA가 일반적이니 채널 스왑 필요 여부 확인
+        jobject bmp = createArgbBitmap(env, rgba.cols, rgba.rows);
 
         AndroidBitmapInfo info;
         void *pixels = nullptr;
@@ -49,6 +56,24 @@ namespace bmp
         return bmp;
     }
 
+    jobject payloadToBitmap(JNIEnv *env, const thermal::Payload &pl)
+    {
+        // statsOnly 결과처럼 이미지가 없는 스테이지는 null (Java 쪽 Bitmap은 nullable)
+        if (!pl.hasImage())
+            return nullptr;
+        // 중간 cv::Mat 없이 잠근 픽셀(stride 포함)에 스테이지를 바로 합성
+        const cv::Size sz = pl.size();
+        jobject bmp = createArgbBitmap(env, sz.width, sz.height);
+
+        AndroidBitmapInfo info;
+        void *pixels = nullptr;
+        AndroidBitmap_getInfo(env, bmp, &info);
+        AndroidBitmap_lockPixels(env, bmp, &pixels);
+        pl.renderTo(pixels, info.stride);
+        AndroidBitmap_unlockPixels(env, bmp);
+        return bmp;
+    }
+
     cv::Mat bitmapToMat(JNIEnv *env, jobject bitmap)
     {
         AndroidBitmapInfo info{};
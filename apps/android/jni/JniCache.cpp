@@ -57,8 +57,8 @@ namespace jni
         {
             const auto &pl = res.stages[i];
 
-            // cv::Mat -> Bitmap (ARGB_8888)
-            jobject jBmp = bmp::matToBitmap(env, pl.rgba); // 구현돼 있다고 가정
+            // Payload -> Bitmap (ARGB_8888), 픽셀에 직접 합성
+            jobject jBmp = bmp::payloadToBitmap(env, pl);
 
             // NewObject로 StagePayload 생성
             // 시그니처가 "(Landroid/graphics/Bitmap;FIF)V" 라는 가정: (bitmap, percent, labelId, thresholdQ)
@@ -71,7 +71,7 @@ namespace JniConfig
 
         for (const auto &st : R.stages)
         {
-            jobject bmp = bmp::matToBitmap(env, st.rgba);
+            jobject bmp = bmp::payloadToBitmap(env, st);
             jobject pl = env->NewObject(clsPayload, ctorP, bmp, st.mortarPermille, st.labelId, st.thresholdQ);
             env->CallBooleanMethod(list, add, pl);
             env->DeleteLocalRef(pl);
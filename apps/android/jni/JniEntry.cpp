@@ -37,6 +37,7 @@ static jobject native_processStagesWithRoi(JNIEnv *env, jclass,
     p.doBilateral = doBilateral;
     p.stageSteps = stageSteps;
     p.maxK = maxK;
+    p.scoreGroups = true; // usedK/labelId를 Java로 넘기므로 그룹 적합 필요
     p.refineMode = refineMode;
     p.refineSteps = refineSteps;
     p.stageIdx = stageIdx;
@@ -65,7 +66,7 @@ static jobject native_processStagesWithRoi(JNIEnv *env, jclass,
 
     for (const auto &pl : R.stages)
     {
-        jobject bmp = bmp::matToBitmap(env, pl.rgba); // cv::Mat -> Bitmap
+        jobject bmp = bmp::payloadToBitmap(env, pl); // 스테이지 -> Bitmap (직접 합성)
         jobject payload = env->NewObject(clsPayload, ctorPayload,
                                          bmp,
                                          (jfloat)pl.mortarPermille,
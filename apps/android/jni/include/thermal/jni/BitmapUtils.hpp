@@ -1,9 +1,11 @@
 #pragma once
 #include <jni.h>
 #include <opencv2/core.hpp>
+#include "thermal/core.hpp"
 
 namespace bmp
 {
     jobject matToBitmap(JNIEnv *env, const cv::Mat &rgba); // ARGB_8888 Bitmap 반환
+    jobject payloadToBitmap(JNIEnv *env, const thermal::Payload &pl); // 비트맵 픽셀에 직접 합성, 이미지 없으면 null
     cv::Mat bitmapToMat(JNIEnv *env, jobject bitmap);
 }
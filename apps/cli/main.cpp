@@ -5,6 +5,7 @@
 #include <optional>
 #include <cstring>
 #include <cctype>
+#include <chrono>
 
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
@@ -63,20 +64,32 @@ outputs:
 options (안 주면 core.hpp의 기본값 사용):
   --steps <int>           # p.stageSteps (기본 6)
   --maxK <int>            # p.maxK (기본 5, 2..7 권장)
+  --scoreGroups <bool>    # p.scoreGroups: GMM 그룹 적합 (labelId/usedK; 끄면 -1/0, --needLabelIds면 자동)
   --stageIdx <int>        # p.stageIdx (기본 1; 2차 처리 시작 인덱스 같은 용도)
   --refine <bool>         # p.refineMode (true/false)
   --refineSteps <int>     # p.refineSteps
   --bilateral <bool>      # p.doBilateral
   --drawEdges <bool>      # p.drawEdges (슈퍼픽셀 엣지 보이기)
+  --superpixels <bool>    # p.superpixels (슈퍼픽셀 단위로 stage 결정; regionSize/compactness 사용)
   --regionSize <int>      # p.regionSize
   --compactness <int>     # p.compactness
   --mrfLambda <float>     # p.mrfLambda
   --needLabelIds <bool>   # 결과에 labelIds 채워달라고 요청
+  --score <fused|lab|lut3d>  # p.scoreSource (기본 fused)
+  --palette <iron|rainbow|gray>  # 의사 컬러 입력의 팔레트: p.scoreSource = Palette (팔레트 위치를 점수로 사용)
+  --cdf <exact|hist>      # p.cdfMode (기본 hist)
+  --cdfBins <int>         # p.cdfBins (기본 65536)
+  --threads <int>         # p.numThreads (0=자동, 1=단일 스레드)
+  --smooth <bilateral|guided>  # p.smoothMode (--bilateral true 일 때 사용할 필터)
+  --smoothRadius <int>    # p.smoothRadius (guided)
+  --smoothEps <float>     # p.smoothEps (guided)
+  --statsOnly <bool>      # p.statsOnly (이미지 저장 없이 stage 통계만 출력)
+  --bench <int>           # 코어를 N회 반복 호출해서 평균 ms 출력 (필터/모드 속도 비교용)
   --roi "x1,y1;x2,y2;...;xN,yN"   # 폴리곤 ROI
 
 examples:
   thermal_cli in.png out.png --steps 6 --maxK 5 --refine true --refineSteps 5 --stageIdx 1
-  thermal_cli in.png out.png --roi "100,120; 500,130; 520,420; 110,430" --drawEdges true
+  thermal_cli in.png out.png --roi "100,120; 500,130; 520,420; 110,430" --superpixels true --drawEdges true
 )";
 }
 
@@ -93,6 +106,7 @@ int main(int argc, char **argv)
     // 기본 Params (core.hpp 기본과 동일)
     thermal::Params p{};
     bool needLabelIds = false;
+    int benchIters = 0;
     std::optional<thermal::Polygon> roi;
 
     // 간단한 argv 파서
@@ -123,6 +137,12 @@ int main(int argc, char **argv)
         } else if (k=="--drawEdges") {
             bool v; if(!parseBool(needVal(k.c_str()), v)) { std::cerr<<"invalid --drawEdges\n"; return 2; }
             p.drawEdges = v;
+        } else if (k=="--scoreGroups") {
+            bool v; if(!parseBool(needVal(k.c_str()), v)) { std::cerr<<"invalid --scoreGroups\n"; return 2; }
+            p.scoreGroups = v;
+        } else if (k=="--superpixels") {
+            bool v; if(!parseBool(needVal(k.c_str()), v)) { std::cerr<<"invalid --superpixels\n"; return 2; }
+            p.superpixels = v;
         } else if (k=="--regionSize") {
             int v; if(!parseInt(needVal(k.c_str()), v)) { std::cerr<<"invalid --regionSize\n"; return 2; }
             p.regionSize = v;
@@ -135,6 +155,48 @@ int main(int argc, char **argv)
         } else if (k=="--needLabelIds") {
             bool v; if(!parseBool(needVal(k.c_str()), v)) { std::cerr<<"invalid --needLabelIds\n"; return 2; }
             needLabelIds = v;
+        } else if (k=="--score") {
+            auto v = needVal(k.c_str());
+            if (ieq(v, "fused")) p.scoreSource = thermal::ScoreSource::Fused;
+            else if (ieq(v, "lab")) p.scoreSource = thermal::ScoreSource::LabExact;
+            else if (ieq(v, "lut3d")) p.scoreSource = thermal::ScoreSource::Lut3D;
+            else { std::cerr<<"invalid --score\n"; return 2; }
+        } else if (k=="--palette") {
+            auto v = needVal(k.c_str());
+            using Preset = thermal::Palette::Preset;
+            if (ieq(v, "iron")) p.palette = thermal::Palette::preset(Preset::Iron);
+            else if (ieq(v, "rainbow")) p.palette = thermal::Palette::preset(Preset::Rainbow);
+            else if (ieq(v, "gray")) p.palette = thermal::Palette::preset(Preset::Gray);
+            else { std::cerr<<"invalid --palette\n"; return 2; }
+            p.scoreSource = thermal::ScoreSource::Palette;
+        } else if (k=="--cdf") {
+            auto v = needVal(k.c_str());
+            if (ieq(v, "exact")) p.cdfMode = thermal::CdfMode::Exact;
+            else if (ieq(v, "hist")) p.cdfMode = thermal::CdfMode::Histogram;
+            else { std::cerr<<"invalid --cdf\n"; return 2; }
+        } else if (k=="--cdfBins") {
+            int v; if(!parseInt(needVal(k.c_str()), v)) { std::cerr<<"invalid --cdfBins\n"; return 2; }
+            p.cdfBins = v;
+        } else if (k=="--threads") {
+            int v; if(!parseInt(needVal(k.c_str()), v)) { std::cerr<<"invalid --threads\n"; return 2; }
+            p.numThreads = v;
+        } else if (k=="--smooth") {
+            auto v = needVal(k.c_str());
+            if (ieq(v, "bilateral")) p.smoothMode = thermal::SmoothMode::Bilateral;
+            else if (ieq(v, "guided")) p.smoothMode = thermal::SmoothMode::Guided;
+            else { std::cerr<<"invalid --smooth\n"; return 2; }
+        } else if (k=="--smoothRadius") {
+            int v; if(!parseInt(needVal(k.c_str()), v)) { std::cerr<<"invalid --smoothRadius\n"; return 2; }
+            p.smoothRadius = v;
+        } else if (k=="--smoothEps") {
+            float v; if(!parseFloat(needVal(k.c_str()), v)) { std::cerr<<"invalid --smoothEps\n"; return 2; }
+            p.smoothEps = v;
+        } else if (k=="--statsOnly") {
+            bool v; if(!parseBool(needVal(k.c_str()), v)) { std::cerr<<"invalid --statsOnly\n"; return 2; }
+            p.statsOnly = v;
+        } else if (k=="--bench") {
+            int v; if(!parseInt(needVal(k.c_str()), v) || v < 0) { std::cerr<<"invalid --bench\n"; return 2; }
+            benchIters = v;
         } else if (k=="--roi") {
             auto v = needVal(k.c_str());
             roi = parseRoi(v);
@@ -149,28 +211,43 @@ int main(int argc, char **argv)
         }
     }
 
-    // 1) 이미지 로드 & RGBA로 보정
+    // 1) 이미지 로드: BGR/BGRA/GRAY 그대로 코어에 전달 (변환 패스 없음)
     cv::Mat img = cv::imread(inPath, cv::IMREAD_UNCHANGED);
     if (img.empty()) {
         std::cerr << "load fail: " << inPath << "\n";
         return 3;
     }
-    if (img.type() != CV_8UC4) {
-        // BGR/BGRA -> RGBA
-        if (img.channels() == 3) {
-            cv::cvtColor(img, img, cv::COLOR_BGR2RGBA);
-        } else if (img.channels() == 4) {
-            cv::cvtColor(img, img, cv::COLOR_BGRA2RGBA);
-        } else if (img.channels() == 1) {
-            cv::cvtColor(img, img, cv::COLOR_GRAY2RGBA);
-        } else {
-            std::cerr << "unsupported channels: " << img.channels() << "\n";
-            return 3;
+    thermal::PixelFormat format;
+    if (img.type() == CV_8UC3) {
+        format = thermal::PixelFormat::BGR;
+    } else if (img.type() == CV_8UC4) {
+        format = thermal::PixelFormat::BGRA;
+    } else if (img.type() == CV_8UC1) {
+        format = thermal::PixelFormat::Gray;
+    } else {
+        std::cerr << "unsupported image type (8-bit gray/BGR/BGRA only), channels: " << img.channels() << "\n";
+        return 3;
+    }
+    const thermal::ImageView view(img, format);
+
+    // (선택) 벤치마크: 같은 입력으로 N회 호출 (Plan + Engine 재사용 = 스트림 처리와 같은 조건)
+    if (benchIters > 0) {
+        thermal::Plan plan(img.size(), roi, p, /*needLabelIds=*/needLabelIds);
+        if (plan.status() != 0) {
+            std::cerr << "plan failed: status=" << plan.status() << " message=" << plan.message() << "\n";
+            return 4;
         }
+        thermal::Engine engine;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < benchIters; ++i)
+            (void)engine.run(plan, view);
+        auto t1 = std::chrono::steady_clock::now();
+        const double ms = std::chrono::duration<double, std::milli>(t1 - t0).count() / benchIters;
+        std::cout << "bench: " << img.cols << "x" << img.rows << "  " << ms << " ms/call (" << benchIters << " iters)\n";
     }
 
     // 2) 코어 호출
-    auto R = thermal::segmentTempGroups(img, roi, p, /*needLabelIds=*/needLabelIds);
+    auto R = thermal::segmentTempGroups(view, roi, p, /*needLabelIds=*/needLabelIds);
     if (R.status != 0) {
         std::cerr << "segment failed: status=" << R.status << " message=" << R.message << "\n";
         return 4;
@@ -188,8 +265,15 @@ int main(int argc, char **argv)
     }
 
     // 4) 저장
-    if (R.stages.size() == 1) {
-        if (!cv::imwrite(outPath, R.stages[0].rgba)) {
+    if (p.statsOnly) {
+        for (size_t i = 0; i < R.stages.size(); ++i) {
+            std::cout << "stage " << (i + 1)
+                      << "  (mortarPermille=" << R.stages[i].mortarPermille
+                      << ", labelId=" << R.stages[i].labelId
+                      << ", q=" << R.stages[i].thresholdQ << ")\n";
+        }
+    } else if (R.stages.size() == 1) {
+        if (!cv::imwrite(outPath, R.stages[0].rgba())) {
             std::cerr << "write fail: " << outPath << "\n";
             return 6;
         }
@@ -202,7 +286,7 @@ int main(int argc, char **argv)
             char buf[32];
             std::snprintf(buf, sizeof(buf), "_stage_%02zu", i + 1);
             const std::string path = stem + buf + ext;
-            if (!cv::imwrite(path, R.stages[i].rgba)) {
+            if (!cv::imwrite(path, R.stages[i].rgba())) {
                 std::cerr << "write fail: " << path << "\n";
                 return 6;
             }
@@ -214,7 +298,7 @@ int main(int argc, char **argv)
     }
 
     // 5) 요약 로그
-    std::cout << "[usedK=" << R.usedK << "] status=" << R.status
+    std::cout << "[usedK=" << R.usedK << "] cdfError=" << R.cdfError << " status=" << R.status
               << " message=\"" << R.message << "\"";
     if (needLabelIds && !R.labelIds.empty()) {
         std::cout << " labelIds=";
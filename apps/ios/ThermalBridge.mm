@@ -66,8 +66,10 @@ static UIImage* MatToUIImage(const cv::Mat &matRGBA) {
     p.compactness  = params.compactness;
     p.doBilateral  = params.doBilateral;
     p.drawEdges    = params.drawEdges;
+    p.superpixels  = params.superpixels;
     p.mrfLambda    = params.mrfLambda;
     p.maxK         = params.maxK;
+    p.scoreGroups  = true;   // usedK/labelId를 넘기므로 그룹 적합 필요
     p.renderMaxK   = params.renderMaxK;
     p.stageIdx     = params.stageIdx;
     p.stageSteps   = params.stageSteps;
@@ -84,7 +86,7 @@ static UIImage* MatToUIImage(const cv::Mat &matRGBA) {
     NSMutableArray<TRStagePayload*> *stages = [NSMutableArray arrayWithCapacity:R.stages.size()];
     for (const auto &pl : R.stages) {
         TRStagePayload *sp = [TRStagePayload new];
-        sp.image = MatToUIImage(pl.rgba);
+        sp.image = MatToUIImage(pl.rgba());
         sp.mortarPermille = pl.mortarPermille;
         sp.labelId = pl.labelId;
         sp.thresholdQ = pl.thresholdQ;
@@ -26,6 +26,7 @@ NS_ASSUME_NONNULL_BEGIN
 @property(nonatomic, assign) int compactness;
 @property(nonatomic, assign) BOOL doBilateral;
 @property(nonatomic, assign) BOOL drawEdges;
+@property(nonatomic, assign) BOOL superpixels;
 @property(nonatomic, assign) float mrfLambda;
 @property(nonatomic, assign) int maxK;
 @property(nonatomic, assign) int renderMaxK;
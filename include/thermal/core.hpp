@@ -2,9 +2,13 @@
 #include <vector>
 #include <optional>
 #include <string>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <cstdint>
 #include <opencv2/core.hpp>
 
-#define THERMAL_CORE_API_VERSION 0x00010000 // 1.0.0
+#define THERMAL_CORE_API_VERSION 0x00020000 // 2.0.0: Payload::rgba() accessor (was a cv::Mat member)
 
 #ifdef _WIN32
   #ifdef THERMAL_BUILD_DLL
@@ -18,6 +22,19 @@
 
 namespace thermal
 {
+    namespace detail
+    {
+        struct StageRender;
+        struct StageCache;
+        struct PayloadAccess;
+        struct Analysis;
+        struct EngineState;
+        struct PlanState;
+        struct StreamState;
+        struct SchedulerState;
+        struct PaletteLut;
+        struct PaletteAccess;
+    }
 
     struct Polygon
     {
@@ -25,38 +42,513 @@ namespace thermal
         std::vector<int> ys; // image coords
     };
 
+    // Pixel layout of an input frame
+    enum class PixelFormat
+    {
+        RGBA,       // 8-bit interleaved R,G,B,A (the cv::Mat entry points)
+        BGRA,
+        BGR,
+        Gray,
+        NV21,       // Android camera: Y plane + interleaved V,U plane at half resolution
+        NV12,       // Y plane + interleaved U,V plane
+        I420,       // Y plane + U plane + V plane, chroma at half resolution
+        Raw16,      // radiometric counts, 16-bit (see Params::rawGain)
+        RawF32      // radiometric temperature, float
+    };
+
+    // Borrowed frame memory in any PixelFormat. Nothing is converted up front:
+    // the score kernels read the frame directly (YUV is converted row by row,
+    // BT.601 limited range like cvtColor), and only the ROI is turned into RGBA
+    // for the stage images. YUV formats need even width and height; Raw16 / RawF32
+    // data and step must be multiples of the pixel size (2 / 4 bytes), else status -1.
+    struct ImageView
+    {
+        PixelFormat format = PixelFormat::RGBA;
+        int width = 0, height = 0;
+        const void *data = nullptr;     // pixels, or the Y plane
+        size_t step = 0;                // bytes per row of data, 0 = packed
+        const void *chroma = nullptr;   // NV21/NV12 chroma plane, I420 U plane; null = right after data
+        const void *chromaV = nullptr;  // I420 V plane; null = right after chroma
+        size_t chromaStep = 0;          // bytes per chroma row, 0 = packed (width for NV21/NV12, width/2 for I420)
+
+        ImageView() = default;
+        // m holds the frame as laid out by OpenCV (YUV: one CV_8UC1 Mat of height*3/2 rows)
+        ImageView(const cv::Mat &m, PixelFormat f)
+            : format(f), width(m.cols),
+              height(f == PixelFormat::NV21 || f == PixelFormat::NV12 || f == PixelFormat::I420 ? m.rows * 2 / 3 : m.rows),
+              data(m.data), step(m.step)
+        {
+        }
+    };
+
+    // Where the per-pixel score comes from
+    enum class ScoreSource
+    {
+        Fused,      // single-pass 8-bit kernel (default)
+        LabExact,   // float cvtColor BGR->Lab reference path
+        Lut3D,      // precomputed 64^3 RGB->score table, trilinear (see measureScoreError)
+        Palette     // position along Params::palette (pseudo-color frames of a known colormap)
+    };
+
+    // A thermal colormap compiled for inversion: any 8-bit RGB color maps to its
+    // position along the palette (0 = coldest end, 1 = hottest) through a 64^3-cell
+    // table, one lookup per pixel. Colors off the palette take the nearest point
+    // on it. Building the table is a one-off cost of tens of milliseconds (more for
+    // long colorbars), so build a Palette once and reuse it; copies share the table.
+    class Palette
+    {
+    public:
+        enum class Preset
+        {
+            Iron,       // black, blue, magenta, red, orange, yellow, white
+            Rainbow,    // blue, cyan, green, yellow, red
+            Gray        // black to white
+        };
+
+        Palette() = default;    // empty
+
+        THERMAL_API static Palette preset(Preset which);
+
+        // Colors ordered cold to hot (at least 2), linear in between. Empty on bad input.
+        THERMAL_API static Palette fromColors(const std::vector<cv::Vec3b> &rgb);
+
+        // Colorbar sampled from a CV_8UC4 RGBA image: bar is averaged across its short
+        // side and read along its long side, the hot end first if hotFirst (the top of a
+        // vertical bar, the left of a horizontal one). Empty on bad input.
+        THERMAL_API static Palette fromColorbar(const cv::Mat &rgba, const cv::Rect &bar, bool hotFirst = true);
+
+        bool empty() const { return !lut_; }
+
+    private:
+        friend struct detail::PaletteAccess;
+        std::shared_ptr<const detail::PaletteLut> lut_;
+    };
+
+    // How the empirical CDF of the ROI scores is built
+    enum class CdfMode
+    {
+        Histogram,  // O(n) fixed-bin histogram (default)
+        Exact       // std::sort of every ROI score
+    };
+
+    // Edge-preserving smoothing used when Params::doBilateral is set.
+    // Guided: O(1) per pixel in smoothRadius, on the 1-channel score map.
+    enum class SmoothMode
+    {
+        Bilateral,  // cv::bilateralFilter(d=5) on the 3-channel ROI (original behaviour, default)
+        Guided      // self-guided filter on the 1-channel score map: two fused passes, O(1) per pixel in the radius
+    };
+
+    // Cooperative cancellation of calls in flight. Share it through Params::cancel
+    // and call cancel() from any thread: the pipeline polls it between phases and
+    // once per row, and the call returns promptly with status -7 ("Cancelled").
+    // Params::timeoutMs ends a call the same way with status -8.
+    class CancelToken
+    {
+    public:
+        void cancel() noexcept { cancelled_.store(true, std::memory_order_relaxed); }
+        void reset() noexcept { cancelled_.store(false, std::memory_order_relaxed); }
+        bool cancelled() const noexcept { return cancelled_.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<bool> cancelled_{false};
+    };
+
     struct Params
     {
-        int regionSize = 30;
-        int compactness = 12;
+        int regionSize = 30;        // superpixels: grid step (>= 2)
+        int compactness = 12;       // superpixels: spatial weight against score (SLIC m)
         bool doBilateral = false;
-        bool drawEdges = false;     // SuperPixels Edge visibility
+        bool drawEdges = false;     // SuperPixels Edge visibility (outlined in every stage image)
+        bool superpixels = false;   // stages per SLIC superpixel of the rank map instead of per pixel
         float mrfLambda = 0.4f;
-        int maxK = 5;               // 2..7
+        int maxK = 5;               // 1..7: most score groups (GMM components) to consider
+        // Fit the score groups (GMM, up to maxK) behind Payload::labelId and usedK.
+        // Off, no fit runs: labelId -1, usedK 0. Requesting labelIds implies it.
+        bool scoreGroups = false;
         int renderMaxK = 5;         // kept for parity
         int stageIdx = 1;           // base index in stageSteps (for 2nd process)
         int stageSteps = 6;         // stage's step
         bool refineMode = false;    // enable for 2nd process mode
         int refineSteps = 5;        // 2nd stage's step
+        ScoreSource scoreSource = ScoreSource::Fused;
+        Palette palette;            // ScoreSource::Palette: colormap of the input (required, else status -2)
+        CdfMode cdfMode = CdfMode::Histogram;
+        int cdfBins = 65536;        // histogram bins over the [0,1] score range (at most the next power of two >= ROI pixels)
+        SmoothMode smoothMode = SmoothMode::Bilateral;
+        int smoothRadius = 2;       // Guided: window radius
+        float smoothEps = 0.0036f;  // Guided: edge threshold (score variance), ~(15/255)^2
+        // Per-stage statistics only: no images (Payload::hasImage() == false).
+        // Without smoothing or superpixels, Histogram mode counts straight from the
+        // score histogram and splits the bin holding each threshold linearly, so
+        // Payload::mortarPermille may differ from the full path by up to that bin's
+        // share of the ROI (see cdfError for the score resolution). Other modes are exact.
+        bool statsOnly = false;
+        int numThreads = 0;         // row-stripe parallelism: 0 = executor / cv::getNumThreads(), 1 = off (small ROIs always 1)
+        std::shared_ptr<const CancelToken> cancel;  // optional; status -7 once cancelled
+        int timeoutMs = 0;          // 0 = no deadline; else status -8 once a call runs longer
+
+        // Radiometric frames (Raw16 / RawF32) only: no color inversion, the score is
+        // the temperature mapped linearly onto [tempMin, tempMax] -> [0, 1].
+        // Non-finite RawF32 pixels count as tempMin (NaN, -inf) or tempMax (+inf).
+        // scoreSource is ignored and doBilateral smooths with the guided filter.
+        float rawGain = 1.f;        // temperature = raw * rawGain + rawOffset
+        float rawOffset = 0.f;
+        float tempMin = -20.f;
+        float tempMax = 150.f;
+        // Non-empty: absolute stages, stage k selects temperature >= tempThresholds[k]
+        // (ascending, reported in Payload::thresholdQ). No CDF is built.
+        std::vector<float> tempThresholds;
     };
 
     struct Payload {
-        cv::Mat rgba;                   // result(RGBA) for this stage (CV_8UC4, same size as input)
         float mortarPermille = 0.f;     // mortar ratio for this stage
-        int labelId          = -1;      
+        int labelId          = -1;      // score group (0 = coldest) holding most of this stage's pixels; -1 unfitted
         float thresholdQ     = 0.f;     // threshold for this stage
+
+        // result(RGBA) for this stage (CV_8UC4, same size as input).
+        // Composited on first access from the mask shared by all stages, then cached.
+        THERMAL_API const cv::Mat &rgba() const;
+        // Composite into dst (reallocated if not CV_8UC4 input-sized) without caching
+        THERMAL_API void renderTo(cv::Mat &dst) const;
+        // Composite into caller memory: input-sized RGBA rows step bytes apart
+        // (0 = packed), no allocation. false (nothing written) without an image
+        THERMAL_API bool renderTo(void *data, size_t step) const;
+        // Size of the composited image (input size; empty without an image)
+        THERMAL_API cv::Size size() const;
+        // false for payloads that carry statistics only
+        THERMAL_API bool hasImage() const;
+
+    private:
+        friend struct detail::PayloadAccess;
+        std::shared_ptr<const detail::StageRender> render_;    // shared by every stage of a Result
+        std::shared_ptr<detail::StageCache> cache_;            // per-stage lazily rendered image
+        int stage_ = -1;
     };
 
 
     struct Result
     {
         std::vector<Payload> stages;    // payload by stages
-        std::vector<int> labelIds;      // ROI scanline order; optional
-        int usedK = 0;                  // GMM K actually used
+        std::vector<int> labelIds;      // score group per ROI pixel, scanline order (needLabelIds, not statsOnly)
+        int usedK = 0;                  // GMM K actually used (1..maxK, lowest BIC); 0 when groups were not fitted
+        // Score resolution of the CDF, not a measured error: every quantile knot lies within
+        // cdfError (score units, 1 / bins used) of the sort-based one; 0 with CdfMode::Exact.
+        // The rank remap samples the knot curve on a grid of cells no wider than cdfError,
+        // adding at most the curve's rank change across one cell; with Exact, or when that
+        // grid would have more cells than the ROI has pixels, it follows the curve itself.
+        float cdfError = 0.f;
         int status = 0;                 // 0 ok; negative error
         std::string message;
     };
 
+    // Progressive delivery: called with each stage as soon as its payload is ready
+    // (index, then in ascending order). Return false to stop after this stage; the
+    // remaining stages are not computed and Result::stages ends with it.
+    using StageSink = std::function<bool(int stage, const Payload &payload)>;
+
+    // Caller-owned destination of one stage image (see Payload::renderTo(void *, size_t)).
+    // Buffers are written only after the whole call succeeds (status 0); a cancelled (-7),
+    // timed out (-8) or failed call leaves them untouched. A stage outside
+    // 0..stages-1, or Params::statsOnly (no images), is rejected with status -2.
+    // Entries with data == nullptr are ignored.
+    struct StageOutput
+    {
+        int stage = 0;              // index into Result::stages
+        void *data = nullptr;       // input-sized CV_8UC4 rows
+        size_t step = 0;            // bytes per row, 0 = packed (cols * 4)
+    };
+
+    struct ScoreError
+    {
+        float maxAbs = 0.f;
+        float meanAbs = 0.f;
+    };
+
+    // Score deviation of a source from ScoreSource::LabExact over all 2^24 8-bit colors.
+    // Runs the real cvtColor path of this build; takes about a second.
+    // ScoreSource::Palette measures a different quantity and reports zeros.
+    THERMAL_API ScoreError measureScoreError(ScoreSource source);
+
+    // One image + ROI analysed once, then re-thresholded cheaply.
+    // The constructor runs the image-dependent part of segmentTempGroups (score,
+    // smoothing, CDF, rank remap) and keeps the rank map, the ROI spans and a copy
+    // of the input inside the ROI box. run() only redoes the stage schedule, so
+    // first pass / refine pass / stage changes on the same image skip the pipeline.
+    class Session
+    {
+    public:
+        // Analysis fields of p (scoreSource, cdfMode, cdfBins, doBilateral, smooth*,
+        // maxK, scoreGroups, superpixels, regionSize, compactness, numThreads) are
+        // fixed here; the groups are fitted once and shared by every run().
+        THERMAL_API Session(const cv::Mat &inRgba, // CV_8UC4
+                            const std::optional<Polygon> &roi,
+                            const Params &p);
+
+        THERMAL_API int status() const;                 // 0 ok; same codes as Result::status
+        THERMAL_API const std::string &message() const;
+
+        // Stage schedule from the schedule fields of p (stageSteps, stageIdx, refineMode,
+        // refineSteps, statsOnly); analysis fields are ignored. Same stages as
+        // segmentTempGroups with the construction Params. const: safe from several threads.
+        // needLabelIds fills Result::labelIds from the groups fitted at construction, so
+        // it needs Params::scoreGroups there (else labelIds stays empty).
+        THERMAL_API Result run(const Params &p, bool needLabelIds = false) const;
+        THERMAL_API Result run(const Params &p, const StageSink &onStage, bool needLabelIds = false) const;
+
+    private:
+        std::shared_ptr<const detail::Analysis> analysis_;
+        int status_ = 0;
+        std::string message_;
+    };
+
+    // Frame size, ROI and Params compiled once for fixed-geometry streams:
+    // Params are validated, the ROI is rasterized, the threshold schedule is
+    // computed and the score kernel is picked (its tables built). Per frame only
+    // the image-dependent work is left; execute with Engine::run(plan, frame).
+    // The row-stripe split (Params::numThreads = 0) is resolved at each run, so it
+    // follows the executor and cv::getNumThreads() in effect then.
+    // Immutable after construction: one Plan may be shared by any number of
+    // threads, each with its own Engine.
+    class Plan
+    {
+    public:
+        THERMAL_API Plan(cv::Size frameSize,
+                         const std::optional<Polygon> &roi,
+                         const Params &p,
+                         bool needLabelIds = false);
+
+        THERMAL_API int status() const;                 // 0 ok; -1 empty frame size; -2 invalid Params
+        THERMAL_API const std::string &message() const;
+        THERMAL_API cv::Size frameSize() const;
+
+    private:
+        friend class Engine;
+        std::shared_ptr<const detail::PlanState> state_;
+        int status_ = 0;
+        std::string message_;
+    };
+
+    // segmentTempGroups with persistent scratch memory, for frame streams.
+    // Every intermediate buffer (score, Lab, histograms, masks, CDF, spans) is
+    // grow-only and sized for the largest frame seen, so repeated calls on
+    // same-sized frames do not touch the heap for scratch. The stage map and ROI
+    // copy behind the payloads are recycled too, once no payload of an earlier
+    // result references them; the Result itself (payload vector) is allocated
+    // per call.
+    // Thread safety: an Engine is not reentrant, use one per thread (or lock).
+    // Results are independent of the engine and may outlive it or be read from
+    // any thread.
+    class Engine
+    {
+    public:
+        THERMAL_API Engine();
+        THERMAL_API ~Engine();
+        THERMAL_API Engine(Engine &&) noexcept;
+        THERMAL_API Engine &operator=(Engine &&) noexcept;
+        Engine(const Engine &) = delete;
+        Engine &operator=(const Engine &) = delete;
+
+        // Same contract and results as segmentTempGroups
+        THERMAL_API Result run(const cv::Mat &inRgba, // CV_8UC4
+                               const std::optional<Polygon> &roi,
+                               const Params &p,
+                               bool needLabelIds = false);
+        THERMAL_API Result run(const cv::Mat &inRgba,
+                               const std::optional<Polygon> &roi,
+                               const Params &p,
+                               const StageSink &onStage,
+                               bool needLabelIds = false);
+        // Same, compositing each requested stage into its buffer as soon as it is ready
+        THERMAL_API Result run(const cv::Mat &inRgba,
+                               const std::optional<Polygon> &roi,
+                               const Params &p,
+                               const std::vector<StageOutput> &outputs,
+                               bool needLabelIds = false);
+        // Any PixelFormat, read in place (see ImageView)
+        THERMAL_API Result run(const ImageView &in,
+                               const std::optional<Polygon> &roi,
+                               const Params &p,
+                               bool needLabelIds = false);
+        THERMAL_API Result run(const ImageView &in,
+                               const std::optional<Polygon> &roi,
+                               const Params &p,
+                               const StageSink &onStage,
+                               bool needLabelIds = false);
+
+        // Execute a plan on one frame (CV_8UC4 of plan.frameSize()). Results match
+        // segmentTempGroups with the plan's ROI and Params.
+        THERMAL_API Result run(const Plan &plan, const cv::Mat &inRgba);
+        THERMAL_API Result run(const Plan &plan, const cv::Mat &inRgba, const StageSink &onStage);
+        THERMAL_API Result run(const Plan &plan, const ImageView &in);
+        THERMAL_API Result run(const Plan &plan, const ImageView &in, const StageSink &onStage);
+
+        // Drop all scratch memory (the next run grows it again)
+        THERMAL_API void release();
+
+    private:
+        std::unique_ptr<detail::EngineState> state_;
+    };
+
+    struct StreamParams
+    {
+        float decay = 0.1f;         // weight of each new frame in the running score histogram, (0, 1]
+        float maxDrift = 0.05f;     // KS distance frame vs running CDF above which the history is dropped
+    };
+
+    // Continuous feed of frames with a temporal CDF. Each frame's scores go into
+    // a histogram that is blended into an exponentially weighted running histogram;
+    // the stage thresholds come from the running CDF and are applied to the scores
+    // directly (quantile -> score), so a frame costs one score pass, one histogram
+    // and one threshold pass: no sort and no rank remap. Thresholds are stable
+    // frame to frame. When the frame's own CDF drifts more than maxDrift from the
+    // running one (scene change), or the frame size or ROI changes, the history
+    // is replaced by the current frame. Params::cdfMode is ignored (histogram of
+    // cdfBins bins). A frame that fails or is stopped (-7/-8) leaves the running
+    // histogram, drift() and rebuilt() as they were. With Params::scoreGroups the
+    // groups are refitted per frame by a few EM steps from the previous frame's
+    // mixture (same K); the K search runs again when the history is rebuilt.
+    // Like Engine: not reentrant, scratch memory is reused.
+    class Stream
+    {
+    public:
+        THERMAL_API explicit Stream(const Params &p, const StreamParams &sp = StreamParams());
+        THERMAL_API ~Stream();
+        THERMAL_API Stream(Stream &&) noexcept;
+        THERMAL_API Stream &operator=(Stream &&) noexcept;
+        Stream(const Stream &) = delete;
+        Stream &operator=(const Stream &) = delete;
+
+        THERMAL_API Result push(const cv::Mat &inRgba, // CV_8UC4
+                                const std::optional<Polygon> &roi = std::nullopt);
+
+        // Forget the running histogram (next frame starts fresh)
+        THERMAL_API void reset();
+        // KS distance of the last completed frame's CDF from the running CDF (0 on a fresh start)
+        THERMAL_API float drift() const;
+        // Last completed frame replaced the history (first frame, drift, or geometry change)
+        THERMAL_API bool rebuilt() const;
+
+    private:
+        std::unique_ptr<detail::StreamState> state_;
+    };
+
+    // Threads supplied by the embedding application. Once installed with
+    // setExecutor, every parallel region of the library runs on it: the row
+    // stripes of each call, the tasks of segmentTempGroupsBatch, the requests of
+    // a Scheduler created afterwards (through post) and (OpenCV 4.5.2+) OpenCV's
+    // own parallel_for_, whose backend is routed here process-wide.
+    class Executor
+    {
+    public:
+        virtual ~Executor() = default;
+        // Threads the executor can run at once (default stripe budget, Params::numThreads = 0)
+        virtual int concurrency() const = 0;
+        // Call fn(i) for every i in [0, count), possibly concurrently and on the
+        // calling thread, and return once all calls finished. fn does not throw.
+        // At most concurrency() threads besides the caller run fn for one call.
+        // Must allow nested calls from inside fn (running them inline is fine).
+        virtual void parallelFor(int count, const std::function<void(int)> &fn) = 0;
+        // Run task once on one of the executor's threads without waiting for it.
+        // The task may block for a whole request and does not throw. Return false
+        // if unsupported (the default): a Scheduler then starts its own threads.
+        virtual bool post(std::function<void()> task)
+        {
+            (void)task;
+            return false;
+        }
+    };
+
+    // Install ex for all later calls (calls in flight keep the one they started
+    // with for their own regions; OpenCV's parallel_for_ switches at once).
+    // nullptr puts back the OpenCV parallel backend and thread count that
+    // were in effect before the first executor was installed (a plugin backend
+    // is reloaded by name; an application's own ParallelForAPI object cannot be
+    // read back from OpenCV and must be reinstalled by the application).
+    THERMAL_API void setExecutor(std::shared_ptr<Executor> ex);
+    THERMAL_API std::shared_ptr<Executor> getExecutor();
+
+    struct BatchJob
+    {
+        cv::Mat image;                      // CV_8UC4
+        std::optional<Polygon> roi;
+        Params params;                      // params.numThreads is decided by the scheduler
+        bool needLabelIds = false;
+    };
+
+    struct BatchReport
+    {
+        std::vector<Result> results;        // one per job, same order
+        int threads = 0;                    // workers used
+        double seconds = 0.0;               // wall time of the whole batch
+        double imagesPerSec = 0.0;
+    };
+
+    // Many jobs on one work-stealing pool that owns every core. Large images are
+    // split into row tiles spread over the pool, small ones are grouped into one
+    // task each so scheduling overhead stays low; idle workers steal from busy
+    // ones, so mixed sizes keep all cores busy. Each worker reuses one Engine;
+    // the pool and its engines persist across calls with the same thread count.
+    // numThreads: 0 = cv::getNumThreads(). While the batch runs, OpenCV's
+    // parallel_for_ (OpenCV 4.5.2+) is routed onto the pool as setExecutor
+    // would route it, and put back afterwards; OpenCV calls from threads outside
+    // the pool run inline meanwhile.
+    // With an Executor installed the same tasks run on it instead and numThreads
+    // is ignored.
+    THERMAL_API BatchReport segmentTempGroupsBatch(const std::vector<BatchJob> &jobs, int numThreads = 0);
+
+    struct SchedulerStats
+    {
+        uint64_t submitted = 0;             // requests accepted
+        uint64_t completed = 0;             // results delivered
+        uint64_t dropped = 0;               // replaced by a newer request while queued
+        uint64_t abandoned = 0;             // cancelled in flight by a newer request (or cancel())
+        int queueDepth = 0;                 // requests waiting now
+        int inFlight = 0;                   // requests running now
+    };
+
+    // Receives the result of a request that was not superseded. Runs on a
+    // scheduler worker thread and must not throw.
+    using ResultCallback = std::function<void(Result &&)>;
+
+    // Latest-wins request coalescing for interactive clients (slider moves, ROI
+    // drags). Requests are keyed by a client/view id: a newer request for a key
+    // replaces the one still queued for it and cancels the one in flight, and
+    // only the latest result per key is delivered. Keys are served in arrival
+    // order, one request per key at a time. Each worker reuses one Engine.
+    // With an Executor installed at construction that supports post, the workers
+    // are tasks posted to it while requests are runnable (at most numWorkers at
+    // once) and the scheduler owns no threads; otherwise it starts numWorkers
+    // threads of its own.
+    class Scheduler
+    {
+    public:
+        THERMAL_API explicit Scheduler(int numWorkers = 1);
+        // Drops queued requests, cancels running ones and waits for the workers
+        // (do not destroy it from a task of its executor)
+        THERMAL_API ~Scheduler();
+        Scheduler(const Scheduler &) = delete;
+        Scheduler &operator=(const Scheduler &) = delete;
+
+        // Queue a request for key. The frame is copied, so the caller may reuse
+        // its buffer. p.cancel is replaced by the scheduler's own token.
+        THERMAL_API void submit(uint64_t key,
+                                const cv::Mat &inRgba, // CV_8UC4
+                                const std::optional<Polygon> &roi,
+                                const Params &p,
+                                ResultCallback done,
+                                bool needLabelIds = false);
+
+        // Drop the queued request of key and abandon the running one (no callback)
+        THERMAL_API void cancel(uint64_t key);
+        // Block until nothing is queued or running
+        THERMAL_API void wait();
+        THERMAL_API SchedulerStats stats() const;
+
+    private:
+        std::unique_ptr<detail::SchedulerState> state_;
+    };
+
     // Pure C++ version of Java_com_chul_thermalimaging_util_ThermalNative_segmentTempGroups
     THERMAL_API Result segmentTempGroups(
         const cv::Mat &inRgba, // CV_8UC4
@@ -64,4 +556,37 @@ namespace thermal
         const Params &p,
         bool needLabelIds = false);
 
+    // Same, delivering each stage to onStage as it becomes ready (see StageSink)
+    THERMAL_API Result segmentTempGroups(
+        const cv::Mat &inRgba, // CV_8UC4
+        const std::optional<Polygon> &roi,
+        const Params &p,
+        const StageSink &onStage,
+        bool needLabelIds = false);
+
+    // Same for a frame in any PixelFormat (camera YUV, BGR(A), gray), read in place
+    THERMAL_API Result segmentTempGroups(
+        const ImageView &in,
+        const std::optional<Polygon> &roi,
+        const Params &p,
+        bool needLabelIds = false);
+
+    // Radiometric frame (CV_16UC1 counts or CV_32FC1 temperatures) straight to
+    // stages, skipping the color-space inversion (see Params::rawGain, tempThresholds).
+    // Stage images show the frame as gray over [tempMin, tempMax].
+    THERMAL_API Result segmentRadiometric(
+        const cv::Mat &raw,
+        const std::optional<Polygon> &roi,
+        const Params &p,
+        bool needLabelIds = false);
+
+    // Same, compositing the requested stages straight into caller buffers
+    // (no per-stage image allocation or copy; see StageOutput)
+    THERMAL_API Result segmentTempGroups(
+        const cv::Mat &inRgba, // CV_8UC4
+        const std::optional<Polygon> &roi,
+        const Params &p,
+        const std::vector<StageOutput> &outputs,
+        bool needLabelIds = false);
+
 } // namespace thermal
@@ -0,0 +1,183 @@
+#ifdef _WIN32
+#ifndef THERMAL_BUILD_DLL
+#define THERMAL_BUILD_DLL 1
+#endif
+#endif
+
+#include "thermal/core.hpp"
+#include "parallel.hpp"
+#include "pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <numeric>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Images at least this large are tiled over the whole pool
+        constexpr int64_t BATCH_TILE_PIXELS = 512 * 512;
+        // Smaller images are grouped into tasks of about this many pixels
+        constexpr int64_t BATCH_GROUP_PIXELS = 1024 * 1024;
+
+        // Pool and per-worker engines kept across batch calls, so threads and
+        // workspaces are not rebuilt per batch. Replaced when the worker count
+        // changes; a batch still running on the old one keeps it alive.
+        struct BatchWorkers
+        {
+            explicit BatchWorkers(int n) : engines(n), pool(n) {}
+            std::vector<Engine> engines;    // engines[worker]: a worker runs one job at a time
+            WorkStealingPool pool;          // declared last: joined before the engines go
+        };
+
+        static std::shared_ptr<BatchWorkers> batchWorkers(int n)
+        {
+            static std::mutex m;
+            // never destroyed: no joins during static destruction
+            static std::shared_ptr<BatchWorkers> &cached = *new std::shared_ptr<BatchWorkers>();
+            std::lock_guard<std::mutex> lk(m);
+            if (!cached || cached->pool.size() != n)
+                cached = std::make_shared<BatchWorkers>(n);
+            return cached;
+        }
+
+        // Engines for executor tasks, shared by every batch (the executor's threads are anonymous)
+        class EngineFreeList
+        {
+        public:
+            std::unique_ptr<Engine> take()
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                if (free_.empty())
+                    return std::unique_ptr<Engine>(new Engine());
+                std::unique_ptr<Engine> e = std::move(free_.back());
+                free_.pop_back();
+                return e;
+            }
+            void give(std::unique_ptr<Engine> e)
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                free_.push_back(std::move(e));
+            }
+            static EngineFreeList &shared()
+            {
+                static EngineFreeList &list = *new EngineFreeList();
+                return list;
+            }
+
+        private:
+            std::mutex m_;
+            std::vector<std::unique_ptr<Engine>> free_;
+        };
+    } // namespace detail
+
+    THERMAL_API BatchReport segmentTempGroupsBatch(const std::vector<BatchJob> &jobs, int numThreads)
+    {
+        BatchReport report;
+        report.results.resize(jobs.size());
+        const std::shared_ptr<Executor> ex = detail::installedExecutor();
+        const int n = ex ? std::max(1, ex->concurrency())
+                         : numThreads > 0 ? numThreads : std::max(1, cv::getNumThreads());
+        report.threads = n;
+        if (jobs.empty())
+            return report;
+
+        const auto t0 = std::chrono::steady_clock::now();
+        {
+            auto runOne = [&](Engine &engine, size_t i, int threads)
+            {
+                const BatchJob &job = jobs[i];
+                Params q = job.params;
+                q.numThreads = threads;
+                try
+                {
+                    report.results[i] = engine.run(job.image, job.roi, q, job.needLabelIds);
+                }
+                catch (const std::exception &e)
+                {
+                    report.results[i] = Result();
+                    report.results[i].status = -100;
+                    report.results[i].message = e.what();
+                }
+            };
+
+            // Largest images first (longest-processing-time order); small ones in groups.
+            // Each task is a list of images and the stripe budget for each of them.
+            std::vector<size_t> order(jobs.size());
+            std::iota(order.begin(), order.end(), (size_t)0);
+            auto pixels = [&](size_t i) { return (int64_t)jobs[i].image.cols * jobs[i].image.rows; };
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return pixels(a) > pixels(b); });
+
+            std::vector<std::pair<std::vector<size_t>, int>> tasks;
+            std::vector<size_t> group;
+            int64_t groupPixels = 0;
+            auto flush = [&]
+            {
+                if (group.empty())
+                    return;
+                tasks.emplace_back(std::move(group), 1);
+                group.clear();
+                groupPixels = 0;
+            };
+            for (size_t i : order)
+            {
+                if (pixels(i) >= detail::BATCH_TILE_PIXELS && n > 1)
+                {
+                    tasks.emplace_back(std::vector<size_t>{i}, n);
+                    continue;
+                }
+                group.push_back(i);
+                groupPixels += pixels(i);
+                if (groupPixels >= detail::BATCH_GROUP_PIXELS)
+                    flush();
+            }
+            flush();
+
+            if (ex)
+            {
+                // Tasks in order on the embedder's threads
+                detail::EngineFreeList &engines = detail::EngineFreeList::shared();
+                ex->parallelFor((int)tasks.size(), [&](int t)
+                {
+                    const detail::ExecutorScope pin(ex);    // the batch's executor, not a later one
+                    std::unique_ptr<Engine> engine = engines.take();
+                    for (size_t i : tasks[t].first)
+                        runOne(*engine, i, tasks[t].second);
+                    engines.give(std::move(engine));
+                });
+            }
+            else
+            {
+                // OpenCV's filters inside a job (bilateral, opening) run on this
+                // pool too, not on threads of their own competing with it
+                const std::shared_ptr<detail::BatchWorkers> workers = detail::batchWorkers(n);
+                const detail::CvBatchScope cvOnPool(n);
+                // Wait for this batch's tasks only: other batches may share the pool
+                std::mutex doneMutex;
+                std::condition_variable doneCv;
+                size_t left = tasks.size();
+                for (const auto &task : tasks)
+                {
+                    workers->pool.submit([&, w = workers.get()](int worker)
+                    {
+                        for (size_t i : task.first)
+                            runOne(w->engines[worker], i, task.second);
+                        std::lock_guard<std::mutex> lk(doneMutex);
+                        if (--left == 0)
+                            doneCv.notify_all();
+                    });
+                }
+                std::unique_lock<std::mutex> lk(doneMutex);
+                doneCv.wait(lk, [&] { return left == 0; });
+            }
+        }
+        const auto t1 = std::chrono::steady_clock::now();
+
+        report.seconds = std::chrono::duration<double>(t1 - t0).count();
+        report.imagesPerSec = report.seconds > 0.0 ? (double)jobs.size() / report.seconds : 0.0;
+        return report;
+    }
+
+} // namespace thermal
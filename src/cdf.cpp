@@ -0,0 +1,180 @@
+#include "cdf.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace thermal
+{
+    namespace detail
+    {
+        static void initKnots(ScoreCdf &out)
+        {
+            out.pk.assign(CDF_KNOTS, 0.f);
+            out.tk.resize(CDF_KNOTS);
+            for (int i = 0; i < CDF_KNOTS; i++)
+                out.tk[i] = (float)i / (float)(CDF_KNOTS - 1);
+        }
+
+        void mergeHistograms(const std::vector<std::vector<uint32_t>> &parts, std::vector<uint32_t> &hist)
+        {
+            hist.clear();
+            if (parts.empty())
+                return;
+            hist.assign(parts[0].begin(), parts[0].end());
+            for (size_t k = 1; k < parts.size(); ++k)
+            {
+                for (size_t b = 0; b < hist.size(); ++b)
+                    hist[b] += parts[k][b];
+            }
+        }
+
+        void buildCdfExact(std::vector<float> &vals, ScoreCdf &out)
+        {
+            initKnots(out);
+            out.maxError = 0.f;
+            if (vals.empty())
+                return;
+            std::sort(vals.begin(), vals.end());
+            const int n = (int)vals.size();
+            for (int i = 0; i < CDF_KNOTS; i++)
+            {
+                int id = std::clamp((int)std::round(out.tk[i] * (n - 1)), 0, n - 1);
+                out.pk[i] = vals[id];
+            }
+        }
+
+        void buildCdfHistogram(const std::vector<uint32_t> &hist, uint64_t n, ScoreCdf &out)
+        {
+            initKnots(out);
+            const int bins = (int)hist.size();
+            out.maxError = bins > 0 ? 1.f / (float)bins : 0.f;
+            if (n == 0 || bins == 0)
+                return;
+
+            // Knot ranks are ascending, so one walk over the bins serves all of them
+            uint64_t cum = 0; // samples in bins [0, b)
+            int b = 0;
+            for (int i = 0; i < CDF_KNOTS; i++)
+            {
+                const uint64_t id = std::min<uint64_t>((uint64_t)std::llround(out.tk[i] * (double)(n - 1)), n - 1);
+                while (b < bins - 1 && cum + hist[b] <= id)
+                    cum += hist[b++];
+                const double inBin = hist[b] ? ((double)(id - cum) + 0.5) / (double)hist[b] : 0.5;
+                out.pk[i] = (float)std::min(1.0, ((double)b + inBin) / (double)bins);
+            }
+        }
+
+        void buildCdfWeighted(const std::vector<double> &hist, double total, double n, ScoreCdf &out)
+        {
+            initKnots(out);
+            const int bins = (int)hist.size();
+            out.maxError = bins > 0 ? 1.f / (float)bins : 0.f;
+            if (!(total > 0.0) || !(n >= 1.0) || bins == 0)
+                return;
+
+            // Knot i sits at the centre of sample tk[i] * (n - 1) of n, i.e. at weight
+            // (tk[i] * (n - 1) + 0.5) / n * total, inside the first non-empty bin
+            // reaching it (slack keeps rounding from running past the last one)
+            const double slack = 1e-9 * total;
+            double cum = 0.0; // weight in bins [0, b)
+            int b = 0;
+            for (int i = 0; i < CDF_KNOTS; i++)
+            {
+                const double w = ((double)out.tk[i] * (n - 1.0) + 0.5) / n * total;
+                while (b < bins - 1 && (!(hist[b] > 0.0) || cum + hist[b] < w - slack))
+                    cum += hist[b++];
+                const double inBin = hist[b] > 0.0 ? std::clamp((w - cum) / hist[b], 0.0, 1.0) : 0.5;
+                out.pk[i] = (float)std::min(1.0, ((double)b + inBin) / (double)bins);
+            }
+        }
+
+        // Reference piecewise-linear interpolation through the knots
+        static float lerpKnots(const ScoreCdf &cdf, float x)
+        {
+            const std::vector<float> &pk = cdf.pk, &tk = cdf.tk;
+            if (!(x > pk.front())) // NaN too
+                return tk.front();
+            if (x >= pk.back())
+                return tk.back();
+            auto it = std::upper_bound(pk.begin(), pk.end(), x);
+            int j = (int)std::distance(pk.begin(), it);
+            int i = j - 1;
+            float t = (x - pk[i]) / (pk[j] - pk[i] + 1e-12f);
+            return tk[i] * (1.f - t) + tk[j] * t;
+        }
+
+        void RankLut::build(const ScoreCdf &cdf, float resolution, int64_t maxCells)
+        {
+            lo = cdf.pk.front();
+            const float hi = cdf.pk.back();
+            const double want = resolution > 0.f ? std::ceil((double)(hi - lo) / resolution) : HUGE_VAL;
+            const double cap = (double)std::clamp<int64_t>(maxCells, 1, RANK_LUT_MAX_CELLS);
+            knots = want > cap ? &cdf : nullptr;
+            if (knots)
+                return;
+            cells = std::max(1, (int)want);
+            r.assign(cells + 2, 0.f);
+            if (!(hi > lo))
+            {
+                // Degenerate ROI (one score value): everything maps to tk.front()
+                r.assign(cells + 2, cdf.tk.front());
+                invStep = 0.f;
+                return;
+            }
+            const float step = (hi - lo) / (float)cells;
+            invStep = 1.f / step;
+            // Cell scores ascend, so one walk over the knots serves them all (same
+            // interpolation as lerpKnots, without a search per cell)
+            const std::vector<float> &pk = cdf.pk, &tk = cdf.tk;
+            const int K = (int)pk.size();
+            int j = 1; // first knot above x
+            for (int i = 1; i < cells; ++i)
+            {
+                const float x = lo + step * (float)i;
+                if (!(x > pk.front()))
+                {
+                    r[i] = tk.front();
+                    continue;
+                }
+                if (x >= pk.back())
+                {
+                    r[i] = tk.back();
+                    continue;
+                }
+                while (j < K - 1 && pk[j] <= x)
+                    ++j;
+                const float t = (x - pk[j - 1]) / (pk[j] - pk[j - 1] + 1e-12f);
+                r[i] = std::clamp(tk[j - 1] * (1.f - t) + tk[j] * t, 0.f, 1.f);
+            }
+            r[0] = cdf.tk.front();
+            r[cells] = cdf.tk.back();
+            r[cells + 1] = r[cells]; // pos == cells reads r[cells + 1]
+        }
+
+        // Clamp, index, lerp: no branch, so the loop vectorizes (the table reads
+        // become gathers with AVX2). R is __restrict because the compiler cannot
+        // version a gather against the stores; src == dst is fine
+        static void lerpGrid(const float *__restrict R, float lo, float invStep, float top,
+                             const float *src, float *dst, int n)
+        {
+            for (int x = 0; x < n; ++x)
+            {
+                const float pos = std::min(std::max(0.f, (src[x] - lo) * invStep), top);
+                const int i = (int)pos;
+                const float t = pos - (float)i;
+                dst[x] = R[i] + t * (R[i + 1] - R[i]);
+            }
+        }
+
+        void RankLut::remapRow(const float *src, float *dst, int n) const
+        {
+            if (knots)
+            {
+                for (int x = 0; x < n; ++x)
+                    dst[x] = std::clamp(lerpKnots(*knots, src[x]), 0.f, 1.f);
+                return;
+            }
+            lerpGrid(r.data(), lo, invStep, (float)cells, src, dst, n);
+        }
+
+    } // namespace detail
+} // namespace thermal
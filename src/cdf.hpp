@@ -0,0 +1,115 @@
+#pragma once
+// Internal empirical-CDF helpers (not installed).
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <opencv2/core.hpp>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Number of (pk, tk) quantile knots of the score -> rank LUT
+        constexpr int CDF_KNOTS = 256;
+
+        struct ScoreCdf
+        {
+            std::vector<float> pk;  // score at quantile tk[i] (non-decreasing)
+            std::vector<float> tk;  // i / (CDF_KNOTS - 1)
+            float maxError = 0.f;   // bound on |pk - sort-based pk| (histogram bin width, score units)
+        };
+
+        // Bin of a score in [0, 1] for a bins-sized histogram. Out-of-range
+        // scores go to the end bins, NaN to bin 0; clamped before the int
+        // conversion, so no input is undefined.
+        inline int scoreBin(float s, int bins)
+        {
+            const float f = s * (float)bins;
+            if (!(f >= 0.f))
+                return 0;
+            return f >= (float)bins ? bins - 1 : (int)f;
+        }
+
+        // Histogram bins used for a ROI of pixels samples: cdfBins clamped to
+        // 256..2^20, and no more than the next power of two >= pixels, since a
+        // small ROI cannot fill more (cdfError reports the bins actually used)
+        inline int cdfBinsFor(int cdfBins, int64_t pixels)
+        {
+            int cap = 256;
+            while (cap < (1 << 20) && cap < pixels)
+                cap <<= 1;
+            return std::min(std::clamp(cdfBins, 256, 1 << 20), cap);
+        }
+
+        // Stripes for per-stripe histograms of bins bins: each stripe clears and
+        // merges all of them, so a stripe gets at least bins pixels
+        inline int histogramStripes(int stripes, int bins, int64_t pixels)
+        {
+            return (int)std::clamp<int64_t>(pixels / bins, 1, stripes);
+        }
+
+        // Sum per-stripe histograms in stripe order into hist (capacity reused)
+        void mergeHistograms(const std::vector<std::vector<uint32_t>> &parts, std::vector<uint32_t> &hist);
+
+        // Exact reference: sorts vals in place, pk[i] = vals[round(q * (n-1))]
+        void buildCdfExact(std::vector<float> &vals, ScoreCdf &out);
+
+        // O(bins) path from a fixed-bin histogram over [0, 1] holding n samples.
+        // Ranks are interpolated inside their bin, so each knot is within 1/bins
+        // (score units) of the sort-based one; maxError records that bound.
+        void buildCdfHistogram(const std::vector<uint32_t> &hist, uint64_t n, ScoreCdf &out);
+
+        // Same from a weighted histogram (e.g. a running average of frames) of total
+        // weight total, read as n samples (knots use the same rank convention)
+        void buildCdfWeighted(const std::vector<double> &hist, double total, double n, ScoreCdf &out);
+
+        // Score whose rank is q under the knot interpolation (inverse of the pk/tk curve)
+        inline float scoreAtRank(const ScoreCdf &cdf, float q)
+        {
+            const int K = (int)cdf.pk.size();
+            const float pos = (q < 0.f ? 0.f : (q > 1.f ? 1.f : q)) * (float)(K - 1);
+            const int i = std::min((int)pos, K - 2);
+            const float t = pos - (float)i;
+            return cdf.pk[i] + t * (cdf.pk[i + 1] - cdf.pk[i]);
+        }
+
+        // Largest rank grid (cells) RankLut builds; finer resolutions interpolate the knots
+        constexpr int RANK_LUT_MAX_CELLS = 1 << 20;
+
+        // Uniform-grid score -> rank table resampled from the pk/tk knots.
+        // Replaces the per-pixel upper_bound over pk with one clamp, one
+        // index and one lerp, so the remap loop is branch-free.
+        // The grid spans [pk.front, pk.back] in cells at most resolution wide (the
+        // CDF's own bin width), however narrow the score band, so the table departs
+        // from the knot curve by at most that curve's rank change across one cell.
+        // resolution 0 (CdfMode::Exact) interpolates the knots directly instead, so
+        // its ranks are the knot curve's, and so does a resolution needing more
+        // than maxCells cells: pass the ROI's pixel count so that filling the
+        // table never costs more than the remap.
+        // Filled by one walk over the knots: O(cells + knots).
+        struct RankLut
+        {
+            std::vector<float> r;   // rank at lo + i * step, cells + 1 entries (+1 pad)
+            float lo = 0.f, invStep = 0.f;
+            int cells = 0;
+            const ScoreCdf *knots = nullptr;    // set: no grid, exact knot interpolation
+
+            // cdf must outlive the table when it interpolates the knots
+            void build(const ScoreCdf &cdf, float resolution, int64_t maxCells = RANK_LUT_MAX_CELLS);
+
+            inline float operator()(float x) const
+            {
+                // NaN (and the NaN of inf * 0 on a degenerate table) reads cell 0
+                const float pos = std::min(std::max(0.f, (x - lo) * invStep), (float)cells);
+                const int i = (int)pos;
+                const float t = pos - (float)i;
+                return r[i] + t * (r[i + 1] - r[i]);
+            }
+
+            // dst[x] = rank(src[x]) over one ROI span (dst may alias src); the
+            // grid or knot loop is chosen once per call, not per pixel
+            void remapRow(const float *src, float *dst, int n) const;
+        };
+
+    } // namespace detail
+} // namespace thermal
@@ -0,0 +1,88 @@
+#pragma once
+// Internal cancellation / deadline state of one call (not installed).
+#include "thermal/core.hpp"
+#include <atomic>
+#include <chrono>
+
+namespace thermal
+{
+    namespace detail
+    {
+        constexpr int STATUS_CANCELLED = -7;
+        constexpr int STATUS_DEADLINE = -8;
+
+        // Created at the start of a call from Params::cancel / timeoutMs and polled
+        // from every row loop (any thread). The first stop reason sticks.
+        class Control
+        {
+        public:
+            explicit Control(const Params &p)
+                : token_(p.cancel.get()), timed_(p.timeoutMs > 0)
+            {
+                if (timed_)
+                    deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(p.timeoutMs);
+            }
+
+            // true once the call should stop
+            bool stop() const
+            {
+                if (status_.load(std::memory_order_relaxed) != 0)
+                    return true;
+                if (token_ && token_->cancelled())
+                    return latch(STATUS_CANCELLED);
+                if (timed_ && std::chrono::steady_clock::now() >= deadline_)
+                    return latch(STATUS_DEADLINE);
+                return false;
+            }
+
+            // 0, or the status to return (polls once)
+            int status() const
+            {
+                stop();
+                return status_.load(std::memory_order_relaxed);
+            }
+
+            // Stop reason latched so far, without polling again (0 = ran to completion)
+            int latched() const
+            {
+                return status_.load(std::memory_order_relaxed);
+            }
+
+            static const char *message(int status)
+            {
+                return status == STATUS_CANCELLED ? "Cancelled" : "Deadline exceeded";
+            }
+
+        private:
+            bool latch(int status) const
+            {
+                int expected = 0;
+                status_.compare_exchange_strong(expected, status, std::memory_order_relaxed);
+                return true;
+            }
+
+            const CancelToken *token_ = nullptr;
+            bool timed_ = false;
+            std::chrono::steady_clock::time_point deadline_;
+            mutable std::atomic<int> status_{0};
+        };
+
+        // A stopped call reports only its status: partial stages are dropped
+        inline void applyStop(const Control &ctl, Result &R)
+        {
+            if (const int st = ctl.latched())
+            {
+                R = Result();
+                R.status = st;
+                R.message = Control::message(st);
+            }
+        }
+
+        // Whether a row loop under ctl (may be null) should stop
+        inline bool stopRequested(const Control *ctl)
+        {
+            return ctl && ctl->stop();
+        }
+
+    } // namespace detail
+} // namespace thermal
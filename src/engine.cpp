@@ -0,0 +1,305 @@
+#ifdef _WIN32
+#ifndef THERMAL_BUILD_DLL
+#define THERMAL_BUILD_DLL 1
+#endif
+#endif
+
+#include "thermal/core.hpp"
+#include "pipeline.hpp"
+#include "plan.hpp"
+#include "payload.hpp"
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Everything an Engine keeps between calls
+        struct EngineState
+        {
+            Analysis analysis;                      // spans and rank map (grow-only)
+            Workspace ws;
+            std::shared_ptr<StageRender> render;    // recycled once the caller drops its payloads
+        };
+
+        // Radiometric frames get their score mapping from p, color frames a valid
+        // score source; 0 or -2 with msg
+        static int prepareFrame(const FrameView &frame, const Params &p, FrameView &in, std::string &msg)
+        {
+            in = frame;
+            if (!in.radiometric())
+                return validateScoreSource(p, msg);
+            if (const int st = validateRadiometric(p, msg))
+                return st;
+            in.mapRaw(p);
+            return 0;
+        }
+
+        static Result runFrame(EngineState &S, const FrameView &frame, const std::optional<Polygon> &roi,
+                               const Params &p, const StageSink &onStage, bool needLabelIds)
+        {
+            Result R;
+            FrameView in;
+            R.status = prepareFrame(frame, p, in, R.message);
+            if (R.status != 0)
+                return R;
+            try
+            {
+                Analysis &a = S.analysis;
+                Workspace &ws = S.ws;
+                const Control ctl(p);
+                const ControlScope scope(ws, ctl);
+
+                // ROI as per-row spans inside its bounding box; every loop
+                // visits span pixels only
+                a.frame = in.size;
+                rasterizeRoi(roi, in.size.width, in.size.height, a.spans, ws.maskBuf);
+                a.stripes = Stripes(a.spans.rect.size(), p.numThreads);
+                // Absolute stages report their temperatures as thresholdQ
+                const bool absolute = absoluteStages(in, p);
+                const std::vector<float> *quantiles = absolute ? &p.tempThresholds : nullptr;
+                if (absolute)
+                    absoluteThresholds(p, ws.thresholds);
+                else
+                    stageThresholds(p, ws.thresholds);
+
+                // Stats-only fast path: the score kernel feeds the histogram directly.
+                // No score map, no stage map, no images; stage counts come from the histogram.
+                if (!absolute && statsFromHistogramApplies(p))
+                {
+                    statsFromHistogram(in, p, a.spans, a.stripes, ws.thresholds, ws, R, &onStage);
+                    applyStop(ctl, R);
+                    return R;
+                }
+
+                // The ROI is copied (converted) into the recycled render buffer by stageResult
+                a.roiRgba.release();
+                a.source = p.statsOnly ? nullptr : &in;
+                R.status = analyze(in, p, a, ws, R.message, wantsGroups(p, needLabelIds));
+                if (R.status == 0)
+                    stageResult(a, ws.thresholds, p, ws, S.render, R, quantiles, &onStage, needLabelIds);
+                applyStop(ctl, R);
+                // do not keep the caller's frame
+                a.source = nullptr;
+                return R;
+            }
+            catch (const cv::Exception &e)
+            {
+                S.analysis.source = nullptr;
+                R.status = -100;
+                R.message = e.what();
+                return R;
+            }
+        }
+
+        static Result runPlan(EngineState &S, const PlanState &P, const FrameView &frame, const StageSink &onStage)
+        {
+            Result R;
+            FrameView in;
+            R.status = prepareFrame(frame, P.params, in, R.message);
+            if (R.status != 0)
+                return R;
+            try
+            {
+                Analysis &a = S.analysis;
+                Workspace &ws = S.ws;
+                const Control ctl(P.params);
+                const ControlScope scope(ws, ctl);
+                const bool absolute = absoluteStages(in, P.params);
+                const std::vector<float> *thresholds = &P.thresholds;
+                if (absolute)
+                {
+                    absoluteThresholds(P.params, ws.thresholds);
+                    thresholds = &ws.thresholds;
+                }
+
+                // Stripes follow the executor and thread count of this run
+                const Stripes stripes(P.spans.rect.size(), P.params.numThreads);
+                if (P.statsPath && !absolute)
+                {
+                    statsFromHistogram(in, P.params, P.spans, stripes, P.thresholds, ws, R, &onStage, &P.kernel);
+                    applyStop(ctl, R);
+                    return R;
+                }
+
+                // Geometry comes from the plan; assigning into the persistent spans reuses their capacity
+                a.frame = P.frame;
+                a.spans = P.spans;
+                a.stripes = stripes;
+                a.roiRgba.release();
+                a.source = P.params.statsOnly ? nullptr : &in;
+                R.status = analyze(in, P.params, a, ws, R.message, wantsGroups(P.params, P.needLabelIds), &P.kernel);
+                if (R.status == 0)
+                    stageResult(a, *thresholds, P.params, ws, S.render, R,
+                                absolute ? &P.params.tempThresholds : nullptr, &onStage, P.needLabelIds);
+                applyStop(ctl, R);
+                a.source = nullptr;
+                return R;
+            }
+            catch (const cv::Exception &e)
+            {
+                S.analysis.source = nullptr;
+                R.status = -100;
+                R.message = e.what();
+                return R;
+            }
+        }
+    } // namespace detail
+
+    THERMAL_API Engine::Engine()
+        : state_(new detail::EngineState())
+    {
+    }
+
+    THERMAL_API Engine::~Engine() = default;
+    THERMAL_API Engine::Engine(Engine &&) noexcept = default;
+    THERMAL_API Engine &Engine::operator=(Engine &&) noexcept = default;
+
+    THERMAL_API void Engine::release()
+    {
+        state_.reset(new detail::EngineState());
+    }
+
+    THERMAL_API Result Engine::run(
+        const cv::Mat &inRgba,
+        const std::optional<Polygon> &roi,
+        const Params &p,
+        bool needLabelIds)
+    {
+        return run(inRgba, roi, p, StageSink(), needLabelIds);
+    }
+
+    THERMAL_API Result Engine::run(
+        const cv::Mat &inRgba,
+        const std::optional<Polygon> &roi,
+        const Params &p,
+        const StageSink &onStage,
+        bool needLabelIds)
+    {
+        if (inRgba.empty() || inRgba.type() != CV_8UC4)
+        {
+            Result R;
+            R.status = -1;
+            R.message = "Input must be CV_8UC4 RGBA";
+            return R;
+        }
+        if (!state_)
+            state_.reset(new detail::EngineState());
+        return detail::runFrame(*state_, detail::FrameView::fromRgba(inRgba), roi, p, onStage, needLabelIds);
+    }
+
+    THERMAL_API Result Engine::run(
+        const cv::Mat &inRgba,
+        const std::optional<Polygon> &roi,
+        const Params &p,
+        const std::vector<StageOutput> &outputs,
+        bool needLabelIds)
+    {
+        // Buffers are only written once the whole call succeeded: a cancelled, timed
+        // out or failed call leaves them as they were
+        Result R;
+        std::vector<float> thresholds;
+        detail::stageThresholds(p, thresholds);
+        for (const StageOutput &o : outputs)
+        {
+            if (!o.data)
+                continue;
+            if (p.statsOnly)
+            {
+                R.status = -2;
+                R.message = "StageOutput needs stage images (statsOnly is set)";
+                return R;
+            }
+            if (o.stage < 0 || o.stage >= (int)thresholds.size())
+            {
+                R.status = -2;
+                R.message = "StageOutput::stage must be in 0..stages-1";
+                return R;
+            }
+        }
+        R = run(inRgba, roi, p, StageSink(), needLabelIds);
+        if (R.status == 0)
+            detail::writeOutputs(outputs, R);
+        return R;
+    }
+
+    THERMAL_API Result Engine::run(
+        const ImageView &in,
+        const std::optional<Polygon> &roi,
+        const Params &p,
+        bool needLabelIds)
+    {
+        return run(in, roi, p, StageSink(), needLabelIds);
+    }
+
+    THERMAL_API Result Engine::run(
+        const ImageView &in,
+        const std::optional<Polygon> &roi,
+        const Params &p,
+        const StageSink &onStage,
+        bool needLabelIds)
+    {
+        Result R;
+        detail::FrameView frame;
+        R.status = detail::FrameView::fromImage(in, frame, R.message);
+        if (R.status != 0)
+            return R;
+        if (!state_)
+            state_.reset(new detail::EngineState());
+        return detail::runFrame(*state_, frame, roi, p, onStage, needLabelIds);
+    }
+
+    THERMAL_API Result Engine::run(const Plan &plan, const cv::Mat &inRgba)
+    {
+        return run(plan, inRgba, StageSink());
+    }
+
+    THERMAL_API Result Engine::run(const Plan &plan, const cv::Mat &inRgba, const StageSink &onStage)
+    {
+        Result R;
+        if (!plan.state_)
+        {
+            R.status = plan.status_ != 0 ? plan.status_ : -1;
+            R.message = plan.message_;
+            return R;
+        }
+        if (inRgba.empty() || inRgba.type() != CV_8UC4 || inRgba.size() != plan.state_->frame)
+        {
+            R.status = -1;
+            R.message = "Input must be CV_8UC4 RGBA of the planned size";
+            return R;
+        }
+        if (!state_)
+            state_.reset(new detail::EngineState());
+        return detail::runPlan(*state_, *plan.state_, detail::FrameView::fromRgba(inRgba), onStage);
+    }
+
+    THERMAL_API Result Engine::run(const Plan &plan, const ImageView &in)
+    {
+        return run(plan, in, StageSink());
+    }
+
+    THERMAL_API Result Engine::run(const Plan &plan, const ImageView &in, const StageSink &onStage)
+    {
+        Result R;
+        if (!plan.state_)
+        {
+            R.status = plan.status_ != 0 ? plan.status_ : -1;
+            R.message = plan.message_;
+            return R;
+        }
+        detail::FrameView frame;
+        R.status = detail::FrameView::fromImage(in, frame, R.message);
+        if (R.status != 0)
+            return R;
+        if (frame.size != plan.state_->frame)
+        {
+            R.status = -1;
+            R.message = "Input must be of the planned size";
+            return R;
+        }
+        if (!state_)
+            state_.reset(new detail::EngineState());
+        return detail::runPlan(*state_, *plan.state_, frame, onStage);
+    }
+
+} // namespace thermal
@@ -0,0 +1,225 @@
+#ifdef _WIN32
+#ifndef THERMAL_BUILD_DLL
+#define THERMAL_BUILD_DLL 1
+#endif
+#endif
+
+#include "thermal/core.hpp"
+#include "parallel.hpp"
+#include "pool.hpp"
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 2)))
+#include <opencv2/core/parallel/parallel_backend.hpp>
+#define THERMAL_CV_PARALLEL_BACKEND 1
+#endif
+
+namespace thermal
+{
+    namespace detail
+    {
+        static std::shared_ptr<Executor> &executorSlot()
+        {
+            static std::shared_ptr<Executor> ex;
+            return ex;
+        }
+
+        static std::mutex &executorMutex()
+        {
+            static std::mutex m;
+            return m;
+        }
+
+        std::shared_ptr<Executor> installedExecutor()
+        {
+            return std::atomic_load(&executorSlot());
+        }
+
+#ifdef THERMAL_CV_PARALLEL_BACKEND
+        // Thread index within the parallel_for_ region the thread last ran a task of
+        static thread_local uint64_t tlRegion = 0;
+        static thread_local int tlThreadNum = 0;
+
+        // OpenCV parallel_for_ backend forwarding to an Executor
+        class CvExecutorBackend : public cv::parallel::ParallelForAPI
+        {
+        public:
+            explicit CvExecutorBackend(std::shared_ptr<Executor> ex) : ex_(std::move(ex)) {}
+
+            void parallel_for(int tasks, FN_parallel_for_body_cb_t body, void *data) override
+            {
+                // The executor's threads are anonymous: each thread joining the
+                // region takes the next index, so indices are 0-based and unique
+                // among the threads of this region. The caller may join as well,
+                // so up to concurrency() + 1 threads (see getNumThreads)
+                const uint64_t region = ++regions_;
+                std::atomic<int> joined(0);
+                ex_->parallelFor(tasks, [&](int i)
+                {
+                    if (tlRegion != region)
+                    {
+                        tlRegion = region;
+                        tlThreadNum = joined++;
+                    }
+                    body(i, i + 1, data);
+                });
+            }
+            int getThreadNum() const override { return tlThreadNum; }
+            // getThreadNum() < getNumThreads(): the executor's threads plus the caller
+            int getNumThreads() const override { return ex_->concurrency() + 1; }
+            int setNumThreads(int) override { return getNumThreads(); }     // the executor decides
+            const char *getName() const override { return "thermal-executor"; }
+
+        private:
+            std::shared_ptr<Executor> ex_;
+            static std::atomic<uint64_t> regions_;
+        };
+        std::atomic<uint64_t> CvExecutorBackend::regions_{0};
+
+        // OpenCV's backend before the first executor, put back by setExecutor(nullptr)
+        struct SavedCvBackend
+        {
+            bool saved = false;
+            std::string name;   // currentParallelFramework(), empty if none
+            int threads = 0;
+        };
+
+        static SavedCvBackend &savedCvBackend()
+        {
+            static SavedCvBackend s;
+            return s;
+        }
+
+        static void restoreCvBackend(const SavedCvBackend &s)
+        {
+            bool loaded = false;
+            if (!s.name.empty())
+            {
+                // plugin backends (tbb, openmp, ...) reload by name; the built-in
+                // framework is not a plugin and comes back with the empty backend
+                try
+                {
+                    loaded = cv::parallel::setParallelForBackend(s.name, false);
+                }
+                catch (const cv::Exception &)
+                {
+                    loaded = false;
+                }
+            }
+            if (!loaded)
+                cv::parallel::setParallelForBackend(std::shared_ptr<cv::parallel::ParallelForAPI>(), false);
+            cv::setNumThreads(s.threads);
+        }
+
+        static SavedCvBackend currentCvBackend()
+        {
+            SavedCvBackend s;
+            const char *name = cv::currentParallelFramework();
+            s.name = name ? name : "";
+            s.threads = cv::getNumThreads();
+            s.saved = true;
+            return s;
+        }
+
+        // Batch pool of the calling worker as an Executor (inline on other threads)
+        class BatchPoolExecutor : public Executor
+        {
+        public:
+            explicit BatchPoolExecutor(int threads) : threads_(threads) {}
+
+            int concurrency() const override { return threads_ - 1; }   // the calling worker helps
+            void parallelFor(int count, const std::function<void(int)> &fn) override
+            {
+                WorkStealingPool *pool = WorkStealingPool::current();
+                if (pool)
+                {
+                    pool->parallelFor(count, fn);
+                    return;
+                }
+                for (int i = 0; i < count; ++i)
+                    fn(i);
+            }
+
+        private:
+            int threads_;
+        };
+
+        // Open CvBatchScopes and the backend they replaced (installed: still theirs)
+        struct CvBatchState
+        {
+            int open = 0;
+            bool installed = false;
+            SavedCvBackend saved;
+        };
+
+        static CvBatchState &cvBatchState()
+        {
+            static CvBatchState s;
+            return s;
+        }
+#endif
+    } // namespace detail
+
+    THERMAL_API void setExecutor(std::shared_ptr<Executor> ex)
+    {
+        std::lock_guard<std::mutex> lk(detail::executorMutex());
+#ifdef THERMAL_CV_PARALLEL_BACKEND
+        detail::SavedCvBackend &saved = detail::savedCvBackend();
+        if (ex)
+        {
+            detail::CvBatchState &batch = detail::cvBatchState();
+            if (!saved.saved)
+                saved = batch.installed ? batch.saved : detail::currentCvBackend();
+            batch.installed = false;    // the executor's backend now, not the batch's
+            cv::parallel::setParallelForBackend(std::make_shared<detail::CvExecutorBackend>(ex), false);
+        }
+        else if (saved.saved)
+        {
+            detail::restoreCvBackend(saved);
+            saved = detail::SavedCvBackend();
+        }
+#endif
+        std::atomic_store(&detail::executorSlot(), std::move(ex));
+    }
+
+    namespace detail
+    {
+        CvBatchScope::CvBatchScope(int poolThreads)
+        {
+#ifdef THERMAL_CV_PARALLEL_BACKEND
+            std::lock_guard<std::mutex> lk(executorMutex());
+            CvBatchState &batch = cvBatchState();
+            if (batch.open++ == 0 && !installedExecutor() && poolThreads > 1)
+            {
+                batch.saved = currentCvBackend();
+                cv::parallel::setParallelForBackend(
+                    std::make_shared<CvExecutorBackend>(std::make_shared<BatchPoolExecutor>(poolThreads)), false);
+                batch.installed = true;
+            }
+#else
+            (void)poolThreads;
+#endif
+        }
+
+        CvBatchScope::~CvBatchScope()
+        {
+#ifdef THERMAL_CV_PARALLEL_BACKEND
+            std::lock_guard<std::mutex> lk(executorMutex());
+            CvBatchState &batch = cvBatchState();
+            if (--batch.open == 0 && batch.installed)
+            {
+                restoreCvBackend(batch.saved);
+                batch = CvBatchState();
+            }
+#endif
+        }
+    } // namespace detail
+
+    THERMAL_API std::shared_ptr<Executor> getExecutor()
+    {
+        return detail::installedExecutor();
+    }
+
+} // namespace thermal
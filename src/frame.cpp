@@ -0,0 +1,280 @@
+#include "frame.hpp"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Fixed-point BT.601 limited-range YUV -> RGB, the coefficients of cvtColor's
+        // COLOR_YUV2RGB_NV21/NV12/I420 (Q20)
+        static constexpr int YUV_SHIFT = 20;
+        static constexpr int YUV_CY = 1220542, YUV_CUB = 2116026, YUV_CUG = -409993,
+                             YUV_CVG = -852492, YUV_CVR = 1673527;
+
+        static inline uchar clip8(int v)
+        {
+            return (uchar)std::min(std::max(v, 0), 255);
+        }
+
+        FrameView FrameView::fromRgba(const cv::Mat &rgba)
+        {
+            FrameView f;
+            f.format = PixelFormat::RGBA;
+            f.size = rgba.size();
+            f.p0 = rgba.data;
+            f.step0 = rgba.step;
+            return f;
+        }
+
+        int FrameView::fromImage(const ImageView &img, FrameView &out, std::string &msg)
+        {
+            out = FrameView();
+            out.format = img.format;
+            out.size = cv::Size(img.width, img.height);
+            out.p0 = static_cast<const uchar *>(img.data);
+            if (img.width <= 0 || img.height <= 0 || !out.p0)
+            {
+                msg = "Empty input frame";
+                return -1;
+            }
+            int bpp = 1;
+            switch (img.format)
+            {
+            case PixelFormat::RGBA:
+            case PixelFormat::BGRA:
+                bpp = 4;
+                break;
+            case PixelFormat::BGR:
+                bpp = 3;
+                break;
+            case PixelFormat::Raw16:
+                bpp = 2;
+                break;
+            case PixelFormat::RawF32:
+                bpp = 4;
+                break;
+            default:
+                break;
+            }
+            const size_t rowBytes = (size_t)img.width * bpp;
+            out.step0 = img.step ? img.step : rowBytes;
+            if (out.step0 < rowBytes)
+            {
+                msg = "Row step smaller than the frame width";
+                return -1;
+            }
+            // Radiometric rows are read as uint16_t / float in place
+            if (out.radiometric() && (out.step0 % bpp || reinterpret_cast<uintptr_t>(out.p0) % bpp))
+            {
+                msg = "Radiometric data and row step must be aligned to the pixel size";
+                return -1;
+            }
+            if (!out.yuv())
+                return 0;
+
+            if ((img.width & 1) || (img.height & 1))
+            {
+                msg = "YUV frames need even width and height";
+                return -1;
+            }
+            const size_t chromaRows = (size_t)img.height / 2;
+            const bool planar = img.format == PixelFormat::I420;
+            const size_t chromaBytes = planar ? (size_t)img.width / 2 : (size_t)img.width;
+            out.step1 = img.chromaStep ? img.chromaStep : (planar ? out.step0 / 2 : out.step0);
+            if (out.step1 < chromaBytes)
+            {
+                msg = "Chroma step smaller than the chroma width";
+                return -1;
+            }
+            out.p1 = img.chroma ? static_cast<const uchar *>(img.chroma) : out.p0 + out.step0 * (size_t)img.height;
+            if (planar)
+            {
+                out.step2 = out.step1;
+                out.p2 = img.chromaV ? static_cast<const uchar *>(img.chromaV) : out.p1 + out.step1 * chromaRows;
+            }
+            return 0;
+        }
+
+        void FrameView::mapRaw(const Params &p)
+        {
+            const float range = p.tempMax - p.tempMin;
+            rawA = p.rawGain / range;
+            rawB = (p.rawOffset - p.tempMin) / range;
+        }
+
+        // Non-finite raw values (dead or saturated pixels of a float frame) get a
+        // defined score: NaN -> 0 (tempMin), +inf -> 1 (tempMax), -inf -> 0
+        static inline float finiteScore(float v)
+        {
+            return std::isfinite(v) ? v : (v > 0.f ? 1.f : 0.f);
+        }
+
+        void FrameView::rawScoreRow(int y, int x0, int x1, bool clamp, float *dst) const
+        {
+            const uchar *row = p0 + step0 * (size_t)y;
+            const int n = x1 - x0;
+            if (format == PixelFormat::Raw16)
+            {
+                const uint16_t *src = reinterpret_cast<const uint16_t *>(row) + x0;
+                for (int x = 0; x < n; ++x)
+                    dst[x] = (float)src[x] * rawA + rawB;
+            }
+            else
+            {
+                const float *src = reinterpret_cast<const float *>(row) + x0;
+                for (int x = 0; x < n; ++x)
+                    dst[x] = finiteScore(src[x] * rawA + rawB);
+            }
+            if (clamp)
+            {
+                for (int x = 0; x < n; ++x)
+                    dst[x] = std::min(std::max(dst[x], 0.f), 1.f);
+            }
+        }
+
+        void FrameView::rawGrayRow(int y, int x0, int x1, uchar *dst, int cn) const
+        {
+            const uchar *row = p0 + step0 * (size_t)y;
+            const uint16_t *src16 = reinterpret_cast<const uint16_t *>(row);
+            const float *srcF = reinterpret_cast<const float *>(row);
+            for (int x = x0; x < x1; ++x, dst += cn)
+            {
+                const float raw = format == PixelFormat::Raw16 ? (float)src16[x] : srcF[x];
+                const float v = std::min(std::max(finiteScore(raw * rawA + rawB), 0.f), 1.f);
+                const uchar g = (uchar)(v * 255.f + 0.5f);
+                dst[0] = dst[1] = dst[2] = g;
+                if (cn == 4)
+                    dst[3] = 255;
+            }
+        }
+
+        bool FrameView::yuv() const
+        {
+            return format == PixelFormat::NV21 || format == PixelFormat::NV12 || format == PixelFormat::I420;
+        }
+
+        cv::Mat FrameView::mat() const
+        {
+            static const int types[] = {CV_8UC4, CV_8UC4, CV_8UC3, CV_8UC1};
+            return cv::Mat(size, types[(int)format], const_cast<uchar *>(p0), step0);
+        }
+
+        void FrameView::yuvRow(int y, int x0, int x1, uchar *dst, int cn) const
+        {
+            const uchar *Y = p0 + step0 * (size_t)y;
+            const uchar *C = p1 + step1 * (size_t)(y >> 1);
+            const uchar *Cv = p2 ? p2 + step2 * (size_t)(y >> 1) : nullptr;
+            // byte offsets of U and V within an NV chroma pair
+            const int uOff = format == PixelFormat::NV21 ? 1 : 0;
+            const int vOff = 1 - uOff;
+            constexpr int half = 1 << (YUV_SHIFT - 1);
+            for (int x = x0; x < x1; ++x, dst += cn)
+            {
+                int u, v;
+                if (Cv)
+                {
+                    u = C[x >> 1];
+                    v = Cv[x >> 1];
+                }
+                else
+                {
+                    const uchar *pair = C + (x & ~1);
+                    u = pair[uOff];
+                    v = pair[vOff];
+                }
+                u -= 128;
+                v -= 128;
+                const int yy = std::max(0, (int)Y[x] - 16) * YUV_CY;
+                const uchar r = clip8((yy + YUV_CVR * v + half) >> YUV_SHIFT);
+                const uchar g = clip8((yy + YUV_CVG * v + YUV_CUG * u + half) >> YUV_SHIFT);
+                const uchar b = clip8((yy + YUV_CUB * u + half) >> YUV_SHIFT);
+                if (cn == 4)
+                {
+                    dst[0] = r;
+                    dst[1] = g;
+                    dst[2] = b;
+                    dst[3] = 255;
+                }
+                else
+                {
+                    dst[0] = b;
+                    dst[1] = g;
+                    dst[2] = r;
+                }
+            }
+        }
+
+        const uchar *FrameView::kernelRow(int y, int x0, int x1, uchar *buf, PixelLayout &layout) const
+        {
+            switch (format)
+            {
+            case PixelFormat::RGBA:
+                layout = PixelLayout::RGBA;
+                return p0 + step0 * (size_t)y + 4 * (size_t)x0;
+            case PixelFormat::BGRA:
+                layout = PixelLayout::BGRA;
+                return p0 + step0 * (size_t)y + 4 * (size_t)x0;
+            case PixelFormat::BGR:
+                layout = PixelLayout::BGR;
+                return p0 + step0 * (size_t)y + 3 * (size_t)x0;
+            case PixelFormat::Gray:
+                layout = PixelLayout::Gray;
+                return p0 + step0 * (size_t)y + x0;
+            default:
+                layout = PixelLayout::BGR;
+                yuvRow(y, x0, x1, buf, 3);
+                return buf;
+            }
+        }
+
+        void FrameView::toBgr(cv::Rect rect, cv::Mat &dst) const
+        {
+            static const int codes[] = {cv::COLOR_RGBA2BGR, cv::COLOR_BGRA2BGR, -1, cv::COLOR_GRAY2BGR};
+            if (radiometric())
+            {
+                for (int y = 0; y < rect.height; ++y)
+                    rawGrayRow(rect.y + y, rect.x, rect.x + rect.width, dst.ptr<uchar>(y), 3);
+            }
+            else if (yuv())
+            {
+                for (int y = 0; y < rect.height; ++y)
+                    yuvRow(rect.y + y, rect.x, rect.x + rect.width, dst.ptr<uchar>(y), 3);
+            }
+            else if (format == PixelFormat::BGR)
+            {
+                mat()(rect).copyTo(dst);
+            }
+            else
+            {
+                cv::cvtColor(mat()(rect), dst, codes[(int)format]);
+            }
+        }
+
+        void FrameView::toRgba(cv::Rect rect, cv::Mat &dst) const
+        {
+            static const int codes[] = {-1, cv::COLOR_BGRA2RGBA, cv::COLOR_BGR2RGBA, cv::COLOR_GRAY2RGBA};
+            if (radiometric())
+            {
+                for (int y = 0; y < rect.height; ++y)
+                    rawGrayRow(rect.y + y, rect.x, rect.x + rect.width, dst.ptr<uchar>(y), 4);
+            }
+            else if (yuv())
+            {
+                for (int y = 0; y < rect.height; ++y)
+                    yuvRow(rect.y + y, rect.x, rect.x + rect.width, dst.ptr<uchar>(y), 4);
+            }
+            else if (format == PixelFormat::RGBA)
+            {
+                mat()(rect).copyTo(dst);
+            }
+            else
+            {
+                cv::cvtColor(mat()(rect), dst, codes[(int)format]);
+            }
+        }
+
+    } // namespace detail
+} // namespace thermal
@@ -0,0 +1,59 @@
+#pragma once
+// Internal input frame of any PixelFormat (not installed).
+#include "thermal/core.hpp"
+#include "score.hpp"
+#include <string>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Borrowed planes of one input frame. Coordinates are frame coordinates.
+        struct FrameView
+        {
+            PixelFormat format = PixelFormat::RGBA;
+            cv::Size size;
+            const uchar *p0 = nullptr;  // interleaved pixels, or Y
+            size_t step0 = 0;
+            const uchar *p1 = nullptr;  // NV21/NV12 chroma pairs, I420 U
+            size_t step1 = 0;
+            const uchar *p2 = nullptr;  // I420 V
+            size_t step2 = 0;
+            float rawA = 1.f, rawB = 0.f;   // Raw16/RawF32: score = raw * rawA + rawB (mapRaw)
+
+            // View of a CV_8UC4 RGBA Mat
+            static FrameView fromRgba(const cv::Mat &rgba);
+            // Checked view of an ImageView: 0, or -1 with msg
+            static int fromImage(const ImageView &img, FrameView &out, std::string &msg);
+
+            bool radiometric() const
+            {
+                return format == PixelFormat::Raw16 || format == PixelFormat::RawF32;
+            }
+            // Score mapping of a radiometric frame from p (rawGain/rawOffset, tempMin/tempMax)
+            void mapRaw(const Params &p);
+            // Scores of pixels [x0, x1) of row y of a radiometric frame; clamped to [0, 1] if clamp.
+            // Always finite: NaN scores 0, +-inf 1 / 0.
+            void rawScoreRow(int y, int x0, int x1, bool clamp, float *dst) const;
+
+            // Pixels [x0, x1) of row y as a score kernel reads them: the frame
+            // itself for interleaved formats, YUV converted into buf (3 bytes per pixel, BGR).
+            // Not for radiometric frames (rawScoreRow).
+            const uchar *kernelRow(int y, int x0, int x1, uchar *buf, PixelLayout &layout) const;
+            // rect converted into dst (rect-sized, CV_8UC3 BGR / CV_8UC4 RGBA);
+            // radiometric frames as gray scores
+            void toBgr(cv::Rect rect, cv::Mat &dst) const;
+            void toRgba(cv::Rect rect, cv::Mat &dst) const;
+
+        private:
+            bool yuv() const;
+            // YUV row y, pixels [x0, x1) -> B,G,R (cn 3) or R,G,B,255 (cn 4)
+            void yuvRow(int y, int x0, int x1, uchar *dst, int cn) const;
+            // Radiometric row -> gray (cn 3 or 4, opaque)
+            void rawGrayRow(int y, int x0, int x1, uchar *dst, int cn) const;
+            // Interleaved formats as a Mat header
+            cv::Mat mat() const;
+        };
+
+    } // namespace detail
+} // namespace thermal
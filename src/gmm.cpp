@@ -0,0 +1,247 @@
+#include "gmm.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace thermal
+{
+    namespace detail
+    {
+        static constexpr int GMM_MAX_ITERS = 100;
+        static constexpr double GMM_TOL = 1e-7;     // relative log-likelihood change
+        static constexpr double LOG_2PI = 1.8378770664093453;
+
+        struct Mixture
+        {
+            int k = 0;
+            double w[GMM_MAX_K], mu[GMM_MAX_K], var[GMM_MAX_K];
+            double logNorm[GMM_MAX_K], halfInvVar[GMM_MAX_K];  // from w, var (prepare)
+
+            void prepare()
+            {
+                for (int j = 0; j < k; ++j)
+                {
+                    logNorm[j] = std::log(w[j]) - 0.5 * (LOG_2PI + std::log(var[j]));
+                    halfInvVar[j] = 0.5 / var[j];
+                }
+            }
+        };
+
+        // Per-component log(w * N(x | mu, var)) into lp; returns the max
+        static inline double componentLogs(const Mixture &m, double x, double *lp)
+        {
+            double mx = -HUGE_VAL;
+            for (int j = 0; j < m.k; ++j)
+            {
+                const double d = x - m.mu[j];
+                lp[j] = m.logNorm[j] - d * d * m.halfInvVar[j];
+                mx = std::max(mx, lp[j]);
+            }
+            return mx;
+        }
+
+        // Quantile seeds for K components over the m non-empty bins (centres x, sample counts c)
+        static void seedQuantiles(const double *x, const double *c, int m, double n, int K, double varFloor, Mixture &g)
+        {
+            // Seeds: means at the (j + 0.5) / K quantiles, shared variance, equal weights
+            double mean = 0.0, sq = 0.0;
+            for (int i = 0; i < m; ++i)
+            {
+                mean += c[i] * x[i];
+                sq += c[i] * x[i] * x[i];
+            }
+            mean /= n;
+            const double var = std::max(sq / n - mean * mean, varFloor);
+            g.k = K;
+            double cum = 0.0;
+            int i = 0;
+            for (int j = 0; j < K; ++j)
+            {
+                const double target = n * (j + 0.5) / K;
+                while (i < m - 1 && cum + c[i] < target)
+                    cum += c[i++];
+                g.mu[j] = x[i];
+                g.var[j] = std::max(var / ((double)K * K), varFloor);
+                g.w[j] = 1.0 / K;
+            }
+        }
+
+        // EM from the components in g; returns the final log-likelihood
+        static double fitEm(const double *x, const double *c, int m, double n, double varFloor, Mixture &g)
+        {
+            const int K = g.k;
+            double lp[GMM_MAX_K], s0[GMM_MAX_K], s1[GMM_MAX_K], s2[GMM_MAX_K];
+            double ll = -HUGE_VAL;
+            for (int it = 0; it < GMM_MAX_ITERS; ++it)
+            {
+                std::fill(s0, s0 + K, 0.0);
+                std::fill(s1, s1 + K, 0.0);
+                std::fill(s2, s2 + K, 0.0);
+                g.prepare();
+                double cur = 0.0;
+                for (int b = 0; b < m; ++b)
+                {
+                    const double mx = componentLogs(g, x[b], lp);
+                    double sum = 0.0;
+                    for (int j = 0; j < K; ++j)
+                        sum += (lp[j] = std::exp(lp[j] - mx));
+                    cur += c[b] * (mx + std::log(sum));
+                    const double scale = c[b] / sum;
+                    for (int j = 0; j < K; ++j)
+                    {
+                        const double r = lp[j] * scale;
+                        s0[j] += r;
+                        s1[j] += r * x[b];
+                        s2[j] += r * x[b] * x[b];
+                    }
+                }
+                // M step; a component that lost all its samples keeps its place
+                for (int j = 0; j < K; ++j)
+                {
+                    if (s0[j] <= n * 1e-12)
+                    {
+                        g.w[j] = 1e-12;
+                        continue;
+                    }
+                    g.w[j] = s0[j] / n;
+                    g.mu[j] = s1[j] / s0[j];
+                    g.var[j] = std::max(s2[j] / s0[j] - g.mu[j] * g.mu[j], varFloor);
+                }
+                const bool done = std::fabs(cur - ll) <= GMM_TOL * std::fabs(cur);
+                ll = cur;
+                if (done)
+                    break;
+            }
+            return ll;
+        }
+
+        void foldHistogram(const std::vector<uint32_t> &hist, std::vector<double> &out)
+        {
+            const size_t bins = hist.size();
+            out.assign(GMM_BINS, 0.0);
+            for (size_t b = 0; b < bins; ++b)
+                out[b * GMM_BINS / bins] += hist[b];
+        }
+
+        void foldHistogram(const std::vector<double> &hist, std::vector<double> &out)
+        {
+            const size_t bins = hist.size();
+            out.assign(GMM_BINS, 0.0);
+            for (size_t b = 0; b < bins; ++b)
+                out[b * GMM_BINS / bins] += hist[b];
+        }
+
+        void fitScoreGmm(ScoreGmm &g, double n, int maxK, const ScoreCdf *rankCdf, bool warm)
+        {
+            // previous fit, the warm start
+            Mixture prev;
+            prev.k = warm ? std::min(g.k, maxK) : 0;
+            for (int j = 0; j < prev.k; ++j)
+            {
+                prev.w[j] = std::max(g.weight[j], 1e-12);
+                prev.mu[j] = g.mean[j];
+                prev.var[j] = g.var[j];
+            }
+            g.k = 0;
+            g.searched = 0;
+            const double total = std::accumulate(g.hist.begin(), g.hist.end(), 0.0);
+            if ((int)g.hist.size() != GMM_BINS || !(total > 0.0) || !(n > 0.0))
+                return;
+
+            // Non-empty bins as (centre, sample count)
+            double x[GMM_BINS], c[GMM_BINS];
+            int m = 0;
+            for (int b = 0; b < GMM_BINS; ++b)
+            {
+                if (g.hist[b] > 0.0)
+                {
+                    x[m] = (b + 0.5) / GMM_BINS;
+                    c[m++] = g.hist[b] * (n / total);
+                }
+            }
+
+            // More components than occupied bins cannot be told apart
+            const int kMax = std::clamp(std::min(maxK, m), 1, GMM_MAX_K);
+            const double varFloor = 1.0 / ((double)GMM_BINS * GMM_BINS);
+            Mixture best;
+            const bool refine = prev.k > 0 && prev.k <= kMax;
+            if (refine)
+            {
+                // Same K, EM from the previous components: converges in a few steps
+                best = prev;
+                fitEm(x, c, m, n, varFloor, best);
+            }
+            double bestBic = HUGE_VAL, prevBic = HUGE_VAL;
+            int worse = 0;
+            for (int K = 1; !refine && K <= kMax; ++K)
+            {
+                Mixture cand;
+                g.searched = K;
+                seedQuantiles(x, c, m, n, K, varFloor, cand);
+                const double ll = fitEm(x, c, m, n, varFloor, cand);
+                const double bic = -2.0 * ll + (3.0 * K - 1.0) * std::log(n);
+                if (bic < bestBic)
+                {
+                    bestBic = bic;
+                    best = cand;
+                }
+                // Two larger K in a row fitting worse: stop searching
+                worse = bic >= prevBic ? worse + 1 : 0;
+                prevBic = bic;
+                if (worse == 2)
+                    break;
+            }
+
+            // Coldest component first (insertion sort, k <= 7)
+            int order[GMM_MAX_K];
+            for (int j = 0; j < best.k; ++j)
+            {
+                int i = j;
+                for (; i > 0 && best.mu[order[i - 1]] > best.mu[j]; --i)
+                    order[i] = order[i - 1];
+                order[i] = j;
+            }
+            Mixture sorted;
+            sorted.k = best.k;
+            for (int j = 0; j < best.k; ++j)
+            {
+                sorted.w[j] = g.weight[j] = best.w[order[j]];
+                sorted.mu[j] = g.mean[j] = best.mu[order[j]];
+                sorted.var[j] = g.var[j] = best.var[order[j]];
+            }
+            g.k = best.k;
+            if (g.k == 0)
+                return;
+            sorted.prepare();
+
+            // Label table over ranks (uniform mass) or scores (histogram mass)
+            g.label.resize(GMM_CELLS);
+            g.mass.resize(GMM_CELLS);
+            double lp[GMM_MAX_K];
+            for (int i = 0; i < GMM_CELLS; ++i)
+            {
+                const float v = (i + 0.5f) / GMM_CELLS;
+                const double s = rankCdf ? scoreAtRank(*rankCdf, v) : v;
+                componentLogs(sorted, s, lp);
+                g.label[i] = (uint8_t)(std::max_element(lp, lp + sorted.k) - lp);
+                g.mass[i] = rankCdf ? 1.f / GMM_CELLS
+                                    : (float)(g.hist[i * GMM_BINS / GMM_CELLS] / total * GMM_BINS / GMM_CELLS);
+            }
+        }
+
+        int ScoreGmm::dominantAbove(float t) const
+        {
+            if (k <= 0)
+                return -1;
+            double sum[GMM_MAX_K] = {};
+            const float pos = std::clamp(t, 0.f, 1.f) * GMM_CELLS;
+            const int i0 = std::min((int)pos, GMM_CELLS - 1);
+            sum[label[i0]] += mass[i0] * std::min(1.f, (float)(i0 + 1) - pos);
+            for (int i = i0 + 1; i < GMM_CELLS; ++i)
+                sum[label[i]] += mass[i];
+            const int best = (int)(std::max_element(sum, sum + k) - sum);
+            return sum[best] > 0.0 ? best : -1;
+        }
+
+    } // namespace detail
+} // namespace thermal
@@ -0,0 +1,45 @@
+#pragma once
+// Internal 1D Gaussian mixture over the ROI scores (not installed).
+#include "cdf.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace thermal
+{
+    namespace detail
+    {
+        constexpr int GMM_MAX_K = 7;
+        constexpr int GMM_BINS = 256;       // EM histogram over the [0, 1] score range
+        constexpr int GMM_CELLS = 4096;     // label table over the analysis value range
+
+        // Mixture fitted by EM on a GMM_BINS histogram (O(bins) per iteration, not
+        // O(pixels)), components sorted by mean so label 0 is the coldest group.
+        // label/mass tabulate the mixture over the values the stage map reads:
+        // ranks when the analysis remaps scores through a CDF, scores otherwise.
+        struct ScoreGmm
+        {
+            std::vector<double> hist;       // input: GMM_BINS sample weights (foldHistogram)
+            int k = 0;                      // components; 0 = not fitted
+            int searched = 0;               // K values the last fit tried (BIC search; 0 = warm refine)
+            double weight[GMM_MAX_K] = {}, mean[GMM_MAX_K] = {}, var[GMM_MAX_K] = {};
+            std::vector<uint8_t> label;     // GMM_CELLS: most likely component of a value in cell i
+            std::vector<float> mass;        // GMM_CELLS: share of the ROI in cell i
+
+            int labelOf(float v) const { return label[scoreBin(v, GMM_CELLS)]; }
+
+            // Component holding most of the ROI at values >= t; -1 if none
+            int dominantAbove(float t) const;
+        };
+
+        // Sum a bins-sized histogram over [0, 1] (bins >= GMM_BINS) into out
+        void foldHistogram(const std::vector<uint32_t> &hist, std::vector<double> &out);
+        void foldHistogram(const std::vector<double> &hist, std::vector<double> &out);
+
+        // Fit 1..maxK components to g.hist holding n samples and keep the one with
+        // the lowest BIC. rankCdf (null: values are scores) maps scores to the rank
+        // values the label table is laid out over. warm: g holds the fit of a similar
+        // histogram (the previous frame), refined by EM at its K instead of a K search.
+        void fitScoreGmm(ScoreGmm &g, double n, int maxK, const ScoreCdf *rankCdf, bool warm = false);
+
+    } // namespace detail
+} // namespace thermal
@@ -0,0 +1,171 @@
+#ifdef _WIN32
+#ifndef THERMAL_BUILD_DLL
+#define THERMAL_BUILD_DLL 1
+#endif
+#endif
+
+#include "thermal/core.hpp"
+#include "palette.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Colorbars are resampled to at most this many control colors
+        static constexpr int MAX_CONTROL_COLORS = 128;
+
+        // Position table of the polyline through colors (cold -> hot, RGB): every node
+        // takes the nearest point on the polyline, position (segment + t) / segments
+        static std::shared_ptr<const PaletteLut> compilePalette(const std::vector<cv::Vec3f> &colors)
+        {
+            const int N = PaletteLut::N;
+            const int segs = (int)colors.size() - 1;
+            std::vector<cv::Vec3f> dir(segs);
+            std::vector<float> len2(segs);
+            for (int s = 0; s < segs; ++s)
+            {
+                for (int c = 0; c < 3; ++c)
+                    dir[s][c] = colors[s + 1][c] - colors[s][c];
+                len2[s] = dir[s][0] * dir[s][0] + dir[s][1] * dir[s][1] + dir[s][2] * dir[s][2];
+            }
+
+            auto T = std::make_shared<PaletteLut>();
+            T->pos.resize((size_t)N * N * N);
+            uint16_t *pos = T->pos.data();
+            const float scale = 65535.f / (float)segs;
+            parallelStripes(Stripes(cv::Size(N * N, N), 0), [&](int, int r0, int r1)
+            {
+                for (int r = r0; r < r1; ++r)
+                    for (int g = 0; g < N; ++g)
+                        for (int b = 0; b < N; ++b)
+                        {
+                            const float q[3] = {(float)(r << PaletteLut::SHIFT), (float)(g << PaletteLut::SHIFT),
+                                                (float)(b << PaletteLut::SHIFT)};
+                            float best = FLT_MAX, at = 0.f;
+                            for (int s = 0; s < segs; ++s)
+                            {
+                                const cv::Vec3f &c0 = colors[s], &d = dir[s];
+                                const float v0 = q[0] - c0[0], v1 = q[1] - c0[1], v2 = q[2] - c0[2];
+                                const float t = len2[s] > 0.f
+                                                    ? std::clamp((v0 * d[0] + v1 * d[1] + v2 * d[2]) / len2[s], 0.f, 1.f)
+                                                    : 0.f;
+                                const float e0 = v0 - t * d[0], e1 = v1 - t * d[1], e2 = v2 - t * d[2];
+                                const float d2 = e0 * e0 + e1 * e1 + e2 * e2;
+                                if (d2 < best)
+                                {
+                                    best = d2;
+                                    at = (float)s + t;
+                                }
+                            }
+                            pos[((size_t)r * N + g) * N + b] = (uint16_t)std::lround(at * scale);
+                        }
+            });
+            return T;
+        }
+
+        static inline float palettePixel(const uint16_t *T, int R, int G, int B)
+        {
+            constexpr int SH = PaletteLut::SHIFT, M = (1 << SH) - 1;
+            constexpr float INV = 1.f / (float)(1 << SH);
+            constexpr int SR = PaletteLut::N * PaletteLut::N, SG = PaletteLut::N;
+            const uint16_t *c = T + (R >> SH) * SR + (G >> SH) * SG + (B >> SH);
+            const float fr = (float)(R & M) * INV, fg = (float)(G & M) * INV, fb = (float)(B & M) * INV;
+            const float c00 = c[0] + fb * ((float)c[1] - c[0]);
+            const float c01 = c[SG] + fb * ((float)c[SG + 1] - c[SG]);
+            const float c10 = c[SR] + fb * ((float)c[SR + 1] - c[SR]);
+            const float c11 = c[SR + SG] + fb * ((float)c[SR + SG + 1] - c[SR + SG]);
+            const float c0 = c00 + fg * (c01 - c00);
+            const float c1 = c10 + fg * (c11 - c10);
+            return (c0 + fr * (c1 - c0)) * (1.f / 65535.f);
+        }
+
+        void scoreRowPalette(const PaletteLut &lut, const uchar *src, PixelLayout layout, float *dst, int n)
+        {
+            const uint16_t *T = lut.pos.data();
+            if (layout == PixelLayout::RGBA)
+            {
+                for (int x = 0; x < n; ++x, src += 4)
+                    dst[x] = palettePixel(T, src[0], src[1], src[2]);
+            }
+            else if (layout == PixelLayout::Gray)
+            {
+                for (int x = 0; x < n; ++x, ++src)
+                    dst[x] = palettePixel(T, src[0], src[0], src[0]);
+            }
+            else
+            {
+                const int cn = layoutChannels(layout);
+                for (int x = 0; x < n; ++x, src += cn)
+                    dst[x] = palettePixel(T, src[2], src[1], src[0]);
+            }
+        }
+
+    } // namespace detail
+
+    THERMAL_API Palette Palette::preset(Preset which)
+    {
+        switch (which)
+        {
+        case Preset::Iron:
+            return fromColors({{0, 0, 0}, {32, 0, 112}, {112, 0, 160}, {176, 16, 144},
+                               {224, 48, 48}, {248, 128, 0}, {255, 216, 32}, {255, 255, 255}});
+        case Preset::Rainbow:
+            return fromColors({{0, 0, 255}, {0, 255, 255}, {0, 255, 0}, {255, 255, 0}, {255, 0, 0}});
+        default:
+            return fromColors({{0, 0, 0}, {255, 255, 255}});
+        }
+    }
+
+    THERMAL_API Palette Palette::fromColors(const std::vector<cv::Vec3b> &rgb)
+    {
+        Palette pal;
+        if (rgb.size() < 2)
+            return pal;
+        std::vector<cv::Vec3f> colors(rgb.size());
+        for (size_t i = 0; i < rgb.size(); ++i)
+            colors[i] = cv::Vec3f(rgb[i][0], rgb[i][1], rgb[i][2]);
+        pal.lut_ = detail::compilePalette(colors);
+        return pal;
+    }
+
+    THERMAL_API Palette Palette::fromColorbar(const cv::Mat &rgba, const cv::Rect &bar, bool hotFirst)
+    {
+        Palette pal;
+        if (rgba.empty() || rgba.type() != CV_8UC4 || bar.empty() ||
+            (bar & cv::Rect(0, 0, rgba.cols, rgba.rows)) != bar)
+            return pal;
+        const bool vertical = bar.height >= bar.width;
+        const int length = vertical ? bar.height : bar.width;
+        const int width = vertical ? bar.width : bar.height;
+        if (length < 2)
+            return pal;
+
+        // Control color i averages the bar over [i, i + 1) * length / count along
+        // its long side and over the whole short side
+        const int count = std::min(length, detail::MAX_CONTROL_COLORS);
+        std::vector<cv::Vec3f> colors(count);
+        for (int i = 0; i < count; ++i)
+        {
+            const int l0 = (int)((int64_t)length * i / count), l1 = (int)((int64_t)length * (i + 1) / count);
+            double sum[3] = {0.0, 0.0, 0.0};
+            for (int l = l0; l < l1; ++l)
+                for (int w = 0; w < width; ++w)
+                {
+                    const cv::Vec4b &px = vertical ? rgba.at<cv::Vec4b>(bar.y + l, bar.x + w)
+                                                   : rgba.at<cv::Vec4b>(bar.y + w, bar.x + l);
+                    for (int c = 0; c < 3; ++c)
+                        sum[c] += px[c];
+                }
+            const double inv = 1.0 / ((double)(l1 - l0) * width);
+            colors[hotFirst ? count - 1 - i : i] =
+                cv::Vec3f((float)(sum[0] * inv), (float)(sum[1] * inv), (float)(sum[2] * inv));
+        }
+        pal.lut_ = detail::compilePalette(colors);
+        return pal;
+    }
+
+} // namespace thermal
@@ -0,0 +1,31 @@
+#pragma once
+// Internal palette inversion table behind thermal::Palette (not installed).
+#include "thermal/core.hpp"
+#include "score.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Palette position at the 65^3 RGB nodes 0,4,...,256 (r-major), as
+        // position * 65535. Pixels interpolate trilinearly between the nodes of
+        // their cell, like the Lut3D score table.
+        struct PaletteLut
+        {
+            static constexpr int SHIFT = 2;                 // 8-bit value >> 2 -> cell
+            static constexpr int N = (256 >> SHIFT) + 1;    // nodes per axis
+            std::vector<uint16_t> pos;
+        };
+
+        struct PaletteAccess
+        {
+            static const PaletteLut *lut(const Palette &p) { return p.lut_.get(); }
+        };
+
+        // Palette positions of n pixels (T from PaletteAccess::lut)
+        void scoreRowPalette(const PaletteLut &T, const uchar *src, PixelLayout layout, float *dst, int n);
+
+    } // namespace detail
+} // namespace thermal
@@ -0,0 +1,85 @@
+#include "parallel.hpp"
+#include "pool.hpp"
+#include <algorithm>
+
+namespace thermal
+{
+    namespace detail
+    {
+        namespace
+        {
+            struct PinnedExecutor
+            {
+                bool active = false;
+                std::shared_ptr<Executor> ex;
+            };
+            thread_local PinnedExecutor tlPinned;
+        } // namespace
+
+        ExecutorScope::ExecutorScope(std::shared_ptr<Executor> ex)
+            : outer_(!tlPinned.active)
+        {
+            if (outer_)
+            {
+                tlPinned.ex = std::move(ex);
+                tlPinned.active = true;
+            }
+        }
+
+        ExecutorScope::~ExecutorScope()
+        {
+            if (outer_)
+            {
+                tlPinned.active = false;
+                tlPinned.ex.reset();
+            }
+        }
+
+        std::shared_ptr<Executor> callExecutor()
+        {
+            return tlPinned.active ? tlPinned.ex : installedExecutor();
+        }
+
+        Stripes::Stripes(cv::Size roiSize, int numThreads)
+            : rows(roiSize.height)
+        {
+            const int64_t pixels = (int64_t)roiSize.width * roiSize.height;
+            int n = numThreads;
+            if (n <= 0)
+            {
+                const std::shared_ptr<Executor> ex = callExecutor();
+                n = ex ? ex->concurrency() : cv::getNumThreads();
+            }
+            if (pixels < PARALLEL_MIN_PIXELS)
+                n = 1;
+            n = std::min(n, std::max(1, rows / PARALLEL_MIN_ROWS));
+            count = std::max(1, n);
+        }
+
+        void parallelStripes(const Stripes &st, const std::function<void(int, int, int)> &fn)
+        {
+            if (st.count <= 1)
+            {
+                fn(0, 0, st.rows);
+                return;
+            }
+            // On a batch worker the stripes are tiles of the batch's own pool
+            if (WorkStealingPool *pool = WorkStealingPool::current())
+            {
+                pool->parallelFor(st.count, [&](int s) { fn(s, st.begin(s), st.end(s)); });
+                return;
+            }
+            if (const std::shared_ptr<Executor> ex = callExecutor())
+            {
+                ex->parallelFor(st.count, [&](int s) { fn(s, st.begin(s), st.end(s)); });
+                return;
+            }
+            cv::parallel_for_(cv::Range(0, st.count), [&](const cv::Range &r)
+            {
+                for (int s = r.start; s < r.end; ++s)
+                    fn(s, st.begin(s), st.end(s));
+            }, (double)st.count);
+        }
+
+    } // namespace detail
+} // namespace thermal
@@ -0,0 +1,77 @@
+#pragma once
+// Internal row-stripe parallelism (not installed).
+#include "thermal/core.hpp"
+#include <functional>
+#include <memory>
+#include <opencv2/core.hpp>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Below this many pixels a call stays on the calling thread
+        constexpr int PARALLEL_MIN_PIXELS = 256 * 256;
+        // Smallest stripe worth handing to another thread
+        constexpr int PARALLEL_MIN_ROWS = 16;
+
+        // Fixed partition of [0, rows) into stripes. The partition only depends
+        // on the image size and the thread budget, and every reduction in the
+        // pipeline is an integer sum merged in stripe order, so results are
+        // bit-identical for any thread count.
+        struct Stripes
+        {
+            int rows = 0;
+            int count = 1;
+
+            Stripes() = default;
+            // numThreads: 0 = call executor concurrency (cv::getNumThreads() without one), 1 = single-threaded
+            Stripes(cv::Size roiSize, int numThreads);
+
+            int begin(int s) const { return (int)((int64_t)rows * s / count); }
+            int end(int s) const { return (int)((int64_t)rows * (s + 1) / count); }
+        };
+
+        // Executor installed by setExecutor, or null
+        std::shared_ptr<Executor> installedExecutor();
+
+        // Pins the executor of one call on this thread: stripes and regions use
+        // the executor installed when the outermost scope opened, whatever
+        // setExecutor does meanwhile
+        class ExecutorScope
+        {
+        public:
+            ExecutorScope() : ExecutorScope(installedExecutor()) {}
+            // Pins ex (null: cv::parallel_for_) instead
+            explicit ExecutorScope(std::shared_ptr<Executor> ex);
+            ~ExecutorScope();
+            ExecutorScope(const ExecutorScope &) = delete;
+            ExecutorScope &operator=(const ExecutorScope &) = delete;
+
+        private:
+            bool outer_ = false;
+        };
+
+        // Executor pinned by the current ExecutorScope, else the installed one
+        std::shared_ptr<Executor> callExecutor();
+
+        // While open (and no Executor is installed), OpenCV's parallel_for_ runs on
+        // the batch pool of the calling worker, through the same backend as
+        // setExecutor; the backend in effect before is put back when the last
+        // scope closes. Calls from threads outside a batch pool run inline
+        // meanwhile. setExecutor takes over from an open scope.
+        class CvBatchScope
+        {
+        public:
+            explicit CvBatchScope(int poolThreads);
+            ~CvBatchScope();
+            CvBatchScope(const CvBatchScope &) = delete;
+            CvBatchScope &operator=(const CvBatchScope &) = delete;
+        };
+
+        // fn(stripe, y0, y1) for every stripe, concurrently when count > 1
+        // (on the batch pool when called from one of its workers, else on the
+        // call's executor, else cv::parallel_for_)
+        void parallelStripes(const Stripes &st, const std::function<void(int, int, int)> &fn);
+
+    } // namespace detail
+} // namespace thermal
@@ -0,0 +1,118 @@
+#ifdef _WIN32
+#ifndef THERMAL_BUILD_DLL
+#define THERMAL_BUILD_DLL 1
+#endif
+#endif
+
+#include "payload.hpp"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+
+namespace thermal
+{
+    namespace detail
+    {
+        void StageRender::stageMask(int stage, cv::Mat &mask) const
+        {
+            cv::compare(stageMap, (double)stage, mask, cv::CMP_GT);
+            // morphology: If it is too sharp, it is recommended to temporarily disable it.
+            if (open3x3) {
+                cv::morphologyEx(mask, mask, cv::MORPH_OPEN,
+                                cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3,3)));
+            }
+        }
+
+        void StageRender::render(int stage, cv::Mat &dst) const
+        {
+            dst.create(frame, CV_8UC4);
+            compose(stage, dst);
+        }
+
+        void StageRender::compose(int stage, cv::Mat &dst) const
+        {
+            // Select from the stage map directly, or from the opened 0/255 mask
+            cv::Mat mask;
+            const cv::Mat *sel = &stageMap;
+            int cut = stage;
+            if (open3x3)
+            {
+                stageMask(stage, mask);
+                sel = &mask;
+                cut = 0;
+            }
+            const cv::Vec4b black(0, 0, 0, 255);
+            const cv::Vec4b outline(255, 255, 0, 255);
+            const int x0 = roiRect.x, x1 = roiRect.x + roiRect.width;
+            for (int y = 0; y < frame.height; ++y)
+            {
+                cv::Vec4b *D = dst.ptr<cv::Vec4b>(y);
+                const int ry = y - roiRect.y;
+                if (ry < 0 || ry >= roiRect.height)
+                {
+                    std::fill(D, D + frame.width, black);
+                    continue;
+                }
+                const uchar *M = sel->ptr<uchar>(ry);
+                const cv::Vec4b *S = roiRgba.ptr<cv::Vec4b>(ry);
+                std::fill(D, D + x0, black);
+                for (int x = 0; x < roiRect.width; ++x)
+                    D[x0 + x] = M[x] > cut ? S[x] : black;
+                if (!edges.empty())
+                {
+                    const uchar *E = edges.ptr<uchar>(ry);
+                    for (int x = 0; x < roiRect.width; ++x)
+                        if (E[x])
+                            D[x0 + x] = outline;
+                }
+                std::fill(D + x1, D + frame.width, black);
+            }
+        }
+
+        void writeOutputs(const std::vector<StageOutput> &outputs, const Result &R)
+        {
+            for (const StageOutput &o : outputs)
+                if (o.data && o.stage >= 0 && o.stage < (int)R.stages.size())
+                    R.stages[o.stage].renderTo(o.data, o.step);
+        }
+
+    } // namespace detail
+
+    THERMAL_API const cv::Mat &Payload::rgba() const
+    {
+        static const cv::Mat empty;
+        if (!render_ || !cache_)
+            return empty;
+        std::call_once(cache_->once, [this] { render_->render(stage_, cache_->rgba); });
+        return cache_->rgba;
+    }
+
+    THERMAL_API void Payload::renderTo(cv::Mat &dst) const
+    {
+        if (!render_)
+        {
+            dst.release();
+            return;
+        }
+        render_->render(stage_, dst);
+    }
+
+    THERMAL_API bool Payload::renderTo(void *data, size_t step) const
+    {
+        if (!render_ || !data)
+            return false;
+        cv::Mat dst(render_->frame, CV_8UC4, data, step);
+        render_->compose(stage_, dst);
+        return true;
+    }
+
+    THERMAL_API cv::Size Payload::size() const
+    {
+        return render_ ? render_->frame : cv::Size();
+    }
+
+    THERMAL_API bool Payload::hasImage() const
+    {
+        return (bool)render_;
+    }
+
+} // namespace thermal
@@ -0,0 +1,53 @@
+#pragma once
+// Internal shared stage representation behind Payload::rgba() (not installed).
+#include "thermal/core.hpp"
+#include <mutex>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Everything needed to composite any stage of one call
+        struct StageRender
+        {
+            cv::Size frame;         // output size (input size)
+            cv::Rect roiRect;       // ROI bounding box in frame coords
+            cv::Mat roiRgba;        // owned copy of the input inside roiRect (CV_8UC4)
+            cv::Mat stageMap;       // CV_8UC1, roiRect size; stage k selects idx > k
+            cv::Mat edges;          // CV_8UC1, roiRect size: superpixel outlines over every stage; empty = none
+            bool open3x3 = false;   // 3x3 elliptic opening per stage mask (doBilateral)
+            cv::Mat stageBuf, rgbaBuf, edgeBuf; // grow-only storage behind stageMap/roiRgba/edges when recycled
+
+            // ROI-sized 0/255 selection mask of stage k
+            void stageMask(int stage, cv::Mat &mask) const;
+            // Selected pixels pass through, the rest are opaque black
+            void render(int stage, cv::Mat &dst) const;
+            // Same into dst, already frame-sized CV_8UC4 (caller memory)
+            void compose(int stage, cv::Mat &dst) const;
+        };
+
+        struct StageCache
+        {
+            std::once_flag once;
+            cv::Mat rgba;
+        };
+
+        // Composite each stage of a finished call (status 0) into the outputs
+        // requesting it (the caller rejects out-of-range stages beforehand)
+        void writeOutputs(const std::vector<StageOutput> &outputs, const Result &R);
+
+        struct PayloadAccess
+        {
+            static void attach(Payload &pl, std::shared_ptr<const StageRender> render, int stage)
+            {
+                pl.render_ = std::move(render);
+                pl.cache_ = std::make_shared<StageCache>();
+                pl.stage_ = stage;
+            }
+            static const StageRender *render(const Payload &pl) { return pl.render_.get(); }
+            // Whether rgba() has composited (and cached) the image
+            static bool cached(const Payload &pl) { return pl.cache_ && !pl.cache_->rgba.empty(); }
+        };
+
+    } // namespace detail
+} // namespace thermal
@@ -0,0 +1,590 @@
+#include "pipeline.hpp"
+#include "score.hpp"
+#include "cdf.hpp"
+#include "stages.hpp"
+#include "payload.hpp"
+#include "smooth.hpp"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace thermal
+{
+    namespace detail
+    {
+        int validateParams(const Params &p, std::string &msg)
+        {
+            auto fail = [&](const char *what)
+            {
+                msg = what;
+                return -2;
+            };
+            if (p.stageSteps < 1 || p.stageSteps > MAX_STAGES)
+                return fail("stageSteps must be in 1..255");
+            if (p.refineMode && (p.refineSteps < 1 || p.refineSteps > MAX_STAGES))
+                return fail("refineSteps must be in 1..255");
+            if (p.refineMode && (p.stageIdx < 1 || p.stageIdx > p.stageSteps))
+                return fail("stageIdx must be in 1..stageSteps");
+            if (p.cdfMode == CdfMode::Histogram && (p.cdfBins < 256 || p.cdfBins > (1 << 20)))
+                return fail("cdfBins must be in 256..1048576");
+            if (p.doBilateral && p.smoothMode == SmoothMode::Guided && (p.smoothRadius < 1 || !(p.smoothEps > 0.f)))
+                return fail("Guided smoothing needs smoothRadius >= 1 and smoothEps > 0");
+            if (p.numThreads < 0)
+                return fail("numThreads must be >= 0");
+            if (p.timeoutMs < 0)
+                return fail("timeoutMs must be >= 0");
+            if (p.maxK < 1 || p.maxK > GMM_MAX_K)
+                return fail("maxK must be in 1..7");
+            if (p.superpixels && (p.regionSize < 2 || p.compactness < 0))
+                return fail("superpixels need regionSize >= 2 and compactness >= 0");
+            if (const int st = validateScoreSource(p, msg))
+                return st;
+            return validateRadiometric(p, msg);
+        }
+
+        int validateScoreSource(const Params &p, std::string &msg)
+        {
+            if (p.scoreSource == ScoreSource::Palette && p.palette.empty())
+            {
+                msg = "ScoreSource::Palette needs a non-empty palette";
+                return -2;
+            }
+            return 0;
+        }
+
+        int validateRadiometric(const Params &p, std::string &msg)
+        {
+            auto fail = [&](const char *what)
+            {
+                msg = what;
+                return -2;
+            };
+            if (!(p.tempMax > p.tempMin) || !std::isfinite(p.tempMax - p.tempMin))
+                return fail("tempMax must be greater than tempMin");
+            if (!(p.rawGain != 0.f) || !std::isfinite(p.rawGain) || !std::isfinite(p.rawOffset))
+                return fail("rawGain must be finite and non-zero");
+            if ((int)p.tempThresholds.size() > MAX_STAGES)
+                return fail("tempThresholds holds at most 255 stages");
+            if (!std::is_sorted(p.tempThresholds.begin(), p.tempThresholds.end()))
+                return fail("tempThresholds must be ascending");
+            return 0;
+        }
+
+        void absoluteThresholds(const Params &p, std::vector<float> &thresholds)
+        {
+            const float range = p.tempMax - p.tempMin;
+            thresholds.resize(p.tempThresholds.size());
+            for (size_t k = 0; k < thresholds.size(); ++k)
+                thresholds[k] = (p.tempThresholds[k] - p.tempMin) / range;
+        }
+
+        // Status of a stopped call (and its message), 0 to carry on
+        static int stopStatus(const Workspace &ws, std::string &msg)
+        {
+            const int st = ws.control ? ws.control->status() : 0;
+            if (st != 0)
+                msg = Control::message(st);
+            return st;
+        }
+
+        // Threshold schedule (ascending quantiles) for Params: branching methods based on refineMode
+        void stageThresholds(const Params &p, std::vector<float> &thresholds)
+        {
+            thresholds.clear();
+            if (!p.refineMode) {
+                // 1st: Equalize the entire range (absolute quantiles) - Sidx=1..N, q=Sidx/(N+1)
+                const int N = std::max(1, p.stageSteps);
+                for (int Sidx = 1; Sidx <= N; ++Sidx) {
+                    float qAbs = (float)Sidx / (float)(N + 1);
+                    thresholds.push_back(qAbs);
+                }
+            } else {
+                // 2nd: Divide the selection stage Sidx-centered "half-step" window into refineSteps
+                const int N  = std::max(1, p.stageSteps);
+                const int RS = std::max(1, p.refineSteps);
+                const int Sidx  = std::clamp(p.stageIdx, 1, N);
+                float sL = std::max(1.0f, float(Sidx) - 0.4f);
+                float sR = std::min(float(N), float(Sidx) + 0.4f);
+
+                for (int k = 0; k < RS; ++k) {
+                    float t = (RS > 1) ? float(k) / float(RS - 1) : 0.5f; // 0..1
+                    float sFrac = sL * (1.f - t) + sR * t;   // successive stage values (e.g. 2.6, 2.7, ...)
+                    float q = sFrac / float(N + 1);          // Convert to normalized coordinates
+                    thresholds.push_back(std::clamp(q, 0.f, 1.f));
+                }
+            }
+
+            if ((int)thresholds.size() > MAX_STAGES)
+                thresholds.resize(MAX_STAGES);
+        }
+
+        void scoreMap(const FrameView &in, const Params &p, Analysis &a, Workspace &ws, const ScoreKernel *kernelIn)
+        {
+            const RoiSpans &spans = a.spans;
+            const Stripes &stripes = a.stripes;
+            const cv::Rect roiRect = spans.rect;
+            a.open3x3 = p.doBilateral;
+
+            // tMap calculation (L/chroma based score)
+            const bool bgrBilateral = p.doBilateral && p.smoothMode == SmoothMode::Bilateral;
+            a.tMap = scratchMat(a.tMapBuf, roiRect.size(), CV_32F);
+            a.tMap.setTo(cv::Scalar(0));
+            cv::Mat &tMap = a.tMap;
+            if (in.radiometric())
+            {
+                // Temperature straight to score, no color inversion. Absolute stages
+                // compare unclamped scores so temperatures outside the range still order.
+                const bool clamp = !absoluteStages(in, p);
+                parallelStripes(stripes, [&](int, int y0, int y1)
+                {
+                    forEachSpan(spans, y0, y1, ws.control, [&](int y, int x0, int x1)
+                    {
+                        in.rawScoreRow(roiRect.y + y, roiRect.x + x0, roiRect.x + x1, clamp, tMap.ptr<float>(y) + x0);
+                    });
+                });
+            }
+            else if (p.scoreSource == ScoreSource::LabExact)
+            {
+                cv::Mat roiBGR = scratchMat(ws.bgrBuf, roiRect.size(), CV_8UC3);
+                in.toBgr(roiRect, roiBGR);
+                if (bgrBilateral)
+                {
+                    cv::Mat tmp = scratchMat(ws.smoothBuf, roiRect.size(), CV_8UC3);
+                    cv::bilateralFilter(roiBGR, tmp, 5, 15, 3);
+                    roiBGR = tmp;
+                }
+                if (stopRequested(ws.control))
+                    return;
+
+                cv::Mat roiBGR32f = scratchMat(ws.bgr32fBuf, roiRect.size(), CV_32FC3);
+                roiBGR.convertTo(roiBGR32f, CV_32F, 1.0 / 255.0);
+                cv::Mat roiLab = scratchMat(ws.labBuf, roiRect.size(), CV_32FC3);
+                cv::cvtColor(roiBGR32f, roiLab, cv::COLOR_BGR2Lab);
+                parallelStripes(stripes, [&](int, int y0, int y1)
+                {
+                    forEachSpan(spans, y0, y1, ws.control, [&](int y, int x0, int x1)
+                    {
+                        const cv::Vec3f *Lp = roiLab.ptr<cv::Vec3f>(y);
+                        float *Tp = tMap.ptr<float>(y);
+                        for (int x = x0; x < x1; ++x)
+                            Tp[x] = scoreFromLab(Lp[x][0], Lp[x][1], Lp[x][2]);
+                    });
+                });
+            }
+            else
+            {
+                // Fused kernel or 3D table straight from the input frame (YUV rows
+                // converted on the fly); the bilateral filter still needs a BGR copy of the ROI.
+                const ScoreKernel kernel = kernelIn ? *kernelIn : scoreKernel(p);
+                if (bgrBilateral)
+                {
+                    cv::Mat roiBGR = scratchMat(ws.bgrBuf, roiRect.size(), CV_8UC3);
+                    cv::Mat tmp = scratchMat(ws.smoothBuf, roiRect.size(), CV_8UC3);
+                    in.toBgr(roiRect, roiBGR);
+                    cv::bilateralFilter(roiBGR, tmp, 5, 15, 3);
+                    if (stopRequested(ws.control))
+                        return;
+                    parallelStripes(stripes, [&](int, int y0, int y1)
+                    {
+                        forEachSpan(spans, y0, y1, ws.control, [&](int y, int x0, int x1)
+                        {
+                            kernel(tmp.ptr<uchar>(y) + 3 * x0, PixelLayout::BGR, tMap.ptr<float>(y) + x0, x1 - x0);
+                        });
+                    });
+                }
+                else
+                {
+                    ws.convBufs.resize(stripes.count);
+                    parallelStripes(stripes, [&](int s, int y0, int y1)
+                    {
+                        std::vector<uchar> &buf = ws.convBufs[s];
+                        buf.resize((size_t)roiRect.width * 3);
+                        forEachSpan(spans, y0, y1, ws.control, [&](int y, int x0, int x1)
+                        {
+                            PixelLayout layout;
+                            const uchar *Sp = in.kernelRow(roiRect.y + y, roiRect.x + x0, roiRect.x + x1, buf.data(), layout);
+                            kernel(Sp, layout, tMap.ptr<float>(y) + x0, x1 - x0);
+                        });
+                    });
+                }
+            }
+
+            // Guided smoothing runs on the single-channel score map instead (always for
+            // radiometric frames, which have no color image to filter)
+            const bool guided = p.smoothMode == SmoothMode::Guided || in.radiometric();
+            if (p.doBilateral && guided && !stopRequested(ws.control))
+            {
+                // a rectangular ROI needs no mask
+                cv::Mat roiMask;
+                if (spans.pixels != (int64_t)roiRect.area())
+                {
+                    roiMask = scratchMat(ws.maskBuf, roiRect.size(), CV_8UC1);
+                    spans.toMask(roiMask);
+                }
+                // absolute stages keep temperatures outside [tempMin, tempMax] unclamped
+                guidedFilterMasked(tMap, roiMask, std::max(1, p.smoothRadius),
+                                   std::max(1e-6f, p.smoothEps), stripes, ws.guided, !absoluteStages(in, p));
+            }
+        }
+
+        uint64_t scoreHistogram(const Analysis &a, int bins, Workspace &ws)
+        {
+            const RoiSpans &spans = a.spans;
+            const cv::Mat &tMap = a.tMap;
+            // per-stripe histograms, merged in stripe order (integer sums; any
+            // partition gives the same counts)
+            Stripes stripes = a.stripes;
+            stripes.count = histogramStripes(stripes.count, bins, spans.pixels);
+            std::vector<std::vector<uint32_t>> &parts = ws.histParts;
+            parts.resize(stripes.count);
+            parallelStripes(stripes, [&](int s, int y0, int y1)
+            {
+                std::vector<uint32_t> &h = parts[s];
+                h.assign(bins, 0);
+                forEachSpan(spans, y0, y1, ws.control, [&](int y, int x0, int x1)
+                {
+                    const float *Sp = tMap.ptr<float>(y);
+                    for (int x = x0; x < x1; ++x)
+                        h[scoreBin(Sp[x], bins)]++;
+                });
+            });
+            mergeHistograms(parts, ws.hist);
+            uint64_t n = 0;
+            for (uint32_t c : ws.hist)
+                n += c;
+            return n;
+        }
+
+        int analyze(const FrameView &in, const Params &p, Analysis &a, Workspace &ws, std::string &msg,
+                    bool groups, const ScoreKernel *kernel)
+        {
+            a.gmm.k = 0;
+            const RoiSpans &spans = a.spans;
+            const Stripes &stripes = a.stripes;
+            const cv::Rect roiRect = spans.rect;
+            scoreMap(in, p, a, ws, kernel);
+            if (const int st = stopStatus(ws, msg))
+                return st;
+            cv::Mat &tMap = a.tMap;
+            if (absoluteStages(in, p))
+            {
+                // thresholds are temperatures: no CDF, no rank remap
+                if (spans.pixels < 100)
+                {
+                    msg = "Too few pixels in ROI";
+                    return -6;
+                }
+                a.cdfError = 0.f;
+                if (groups)
+                {
+                    const uint64_t n = scoreHistogram(a, GMM_BINS, ws);
+                    foldHistogram(ws.hist, a.gmm.hist);
+                    fitScoreGmm(a.gmm, (double)n, p.maxK, nullptr);
+                }
+                a.superpixels.count = 0;
+                if (p.superpixels)
+                    buildSuperpixels(tMap, spans, stripes, p.regionSize, p.compactness, a.superpixels, ws);
+                return stopStatus(ws, msg);
+            }
+
+            // LUT via empirical CDF
+            ScoreCdf &cdf = ws.cdf;
+            size_t nScores = 0;
+            if (p.cdfMode == CdfMode::Exact)
+            {
+                // per-stripe gathers concatenated in stripe order
+                std::vector<std::vector<float>> &parts = ws.exactParts;
+                parts.resize(stripes.count);
+                parallelStripes(stripes, [&](int s, int y0, int y1)
+                {
+                    std::vector<float> &part = parts[s];
+                    part.clear();
+                    part.reserve((size_t)roiRect.width * (y1 - y0));
+                    forEachSpan(spans, y0, y1, ws.control, [&](int y, int x0, int x1)
+                    {
+                        const float *Sp = tMap.ptr<float>(y);
+                        part.insert(part.end(), Sp + x0, Sp + x1);
+                    });
+                });
+                std::vector<float> &allS = ws.allS;
+                allS.clear();
+                for (size_t s = 0; s < (size_t)stripes.count; ++s)
+                    nScores += parts[s].size();
+                allS.reserve(nScores);
+                for (size_t s = 0; s < (size_t)stripes.count; ++s)
+                    allS.insert(allS.end(), parts[s].begin(), parts[s].end());
+                if (nScores >= 100)
+                    buildCdfExact(allS, cdf);
+                if (groups)
+                {
+                    std::vector<double> &gh = a.gmm.hist;
+                    gh.assign(GMM_BINS, 0.0);
+                    for (float v : allS)
+                        gh[scoreBin(v, GMM_BINS)] += 1.0;
+                }
+            }
+            else
+            {
+                nScores = scoreHistogram(a, cdfBinsFor(p.cdfBins, spans.pixels), ws);
+                if (nScores >= 100)
+                    buildCdfHistogram(ws.hist, nScores, cdf);
+                if (groups)
+                    foldHistogram(ws.hist, a.gmm.hist);
+            }
+            if (const int st = stopStatus(ws, msg))
+                return st;
+            if (nScores < 100)
+            {
+                msg = "Too few pixels in ROI";
+                return -6;
+            }
+            a.cdfError = cdf.maxError;
+            // Groups of the scores, tabulated over the ranks the stage map reads
+            if (groups)
+                fitScoreGmm(a.gmm, (double)nScores, p.maxK, &cdf);
+
+            // Score -> rank remap through a uniform-grid LUT built once from pk/tk
+            // (no larger than the ROI)
+            RankLut &rankLut = ws.rankLut;
+            rankLut.build(cdf, cdf.maxError, (int64_t)nScores);
+            parallelStripes(stripes, [&](int, int y0, int y1)
+            {
+                forEachSpan(spans, y0, y1, ws.control, [&](int y, int x0, int x1)
+                {
+                    float *Sp = tMap.ptr<float>(y) + x0;
+                    rankLut.remapRow(Sp, Sp, x1 - x0);
+                });
+            });
+            a.superpixels.count = 0;
+            if (p.superpixels && !stopRequested(ws.control))
+                buildSuperpixels(tMap, spans, stripes, p.regionSize, p.compactness, a.superpixels, ws);
+            return stopStatus(ws, msg);
+        }
+
+        void stageResult(const Analysis &a, const std::vector<float> &thresholds, const Params &p, Workspace &ws,
+                         std::shared_ptr<StageRender> &render, Result &R,
+                         const std::vector<float> *quantiles, const StageSink *sink, bool needLabelIds)
+        {
+            const RoiSpans &spans = a.spans;
+            const Stripes &stripes = a.stripes;
+            const cv::Rect roiRect = spans.rect;
+            const cv::Mat &tMap = a.tMap;
+            const int roiPixelsTotal = (int)spans.pixels;
+
+            // One pass for all thresholds: 8-bit stage-index map + per-stage histogram
+            const int nT = (int)thresholds.size();
+            // A render still referenced by an earlier result's payloads is left to them
+            if (!render || render.use_count() > 1)
+                render = std::make_shared<StageRender>();
+            else
+                std::atomic_thread_fence(std::memory_order_acquire); // last owner's reads happen before reuse
+            cv::Mat stageMap = scratchMat(render->stageBuf, roiRect.size(), CV_8UC1);
+            stageMap.setTo(cv::Scalar(0));
+            std::vector<uint32_t> &stageCounts = ws.stageCounts;
+            stageCounts.assign(nT + 1, 0);
+            const Superpixels &sp = a.superpixels;
+            if (sp.count > 0)
+            {
+                // Stage per superpixel (counts from their sizes), then gathered into the map
+                std::vector<uchar> &spStage = ws.spStage;
+                spStage.resize(sp.count);
+                for (int i = 0; i < sp.count; ++i)
+                {
+                    const int k = (int)(std::upper_bound(thresholds.begin(), thresholds.end(), sp.value[i]) -
+                                        thresholds.begin());
+                    spStage[i] = (uchar)k;
+                    stageCounts[k] += (uint32_t)sp.size[i];
+                }
+                parallelStripes(stripes, [&](int, int y0, int y1)
+                {
+                    forEachSpan(spans, y0, y1, ws.control, [&](int y, int x0, int x1)
+                    {
+                        const int *Lp = sp.labels.ptr<int>(y);
+                        uchar *Mp = stageMap.ptr<uchar>(y);
+                        for (int x = x0; x < x1; ++x)
+                            Mp[x] = spStage[Lp[x]];
+                    });
+                });
+            }
+            else
+            {
+                std::vector<std::vector<uint32_t>> &stageParts = ws.stageParts;
+                stageParts.resize(stripes.count);
+                for (int s = 0; s < stripes.count; ++s)
+                    stageParts[s].assign(nT + 1, 0);
+                parallelStripes(stripes, [&](int s, int y0, int y1)
+                {
+                    forEachSpan(spans, y0, y1, ws.control, [&](int y, int x0, int x1)
+                    {
+                        stageIndexRow(tMap.ptr<float>(y) + x0, thresholds.data(), nT,
+                                      stageMap.ptr<uchar>(y) + x0, stageParts[s].data(), x1 - x0);
+                    });
+                });
+                for (int s = 0; s < stripes.count; ++s)
+                {
+                    for (int k = 0; k <= nT; ++k)
+                        stageCounts[k] += stageParts[s][k];
+                }
+            }
+            std::vector<int> &selCounts = ws.selCounts;
+            stageSelectedCounts(stageCounts, selCounts);
+
+            // Every payload is derived from the stage map; pixels are composited on demand
+            const bool images = !p.statsOnly && (!a.roiRgba.empty() || a.source);
+            render->frame = a.frame;
+            render->roiRect = roiRect;
+            render->stageMap = stageMap;
+            render->open3x3 = a.open3x3;
+            render->edges.release();
+            if (images && p.drawEdges && sp.count > 0)
+            {
+                render->edges = scratchMat(render->edgeBuf, roiRect.size(), CV_8UC1);
+                parallelStripes(stripes, [&](int, int y0, int y1) { sp.edgeRows(render->edges, y0, y1); });
+            }
+            render->roiRgba.release();
+            if (images && !a.roiRgba.empty())
+            {
+                render->roiRgba = a.roiRgba;
+            }
+            else if (images)
+            {
+                // one pass: copy (RGBA) or conversion of the ROI into the recycled buffer
+                render->roiRgba = scratchMat(render->rgbaBuf, roiRect.size(), CV_8UC4);
+                a.source->toRgba(roiRect, render->roiRgba);
+            }
+
+            R.stages.clear();
+            R.stages.reserve(nT);
+            for (int k = 0; k < nT; ++k) {
+                if (stopRequested(ws.control))
+                    break;
+                thermal::Payload payload;
+                payload.thresholdQ = quantiles ? (*quantiles)[k] : thresholds[k];
+                payload.labelId = a.gmm.dominantAbove(thresholds[k]);
+
+                int selInRoi = selCounts[k];
+                if (a.open3x3) {
+                    // counts after the per-stage opening
+                    cv::Mat stageMaskRoi = scratchMat(ws.maskBuf, roiRect.size(), CV_8UC1);
+                    render->stageMask(k, stageMaskRoi);
+                    selInRoi = cv::countNonZero(stageMaskRoi);
+                }
+
+                // calculate permille by stages
+                payload.mortarPermille = mortarPermille(selInRoi, roiPixelsTotal);
+                if (images)
+                    PayloadAccess::attach(payload, render, k);
+
+                R.stages.emplace_back(std::move(payload));
+                if (sink && *sink && !(*sink)(k, R.stages.back()))
+                    break;
+            }
+            R.cdfError = a.cdfError;
+            R.usedK = a.gmm.k;
+
+            // Group of every ROI pixel, in scanline order
+            R.labelIds.clear();
+            if (needLabelIds && !p.statsOnly && a.gmm.k > 0 && !stopRequested(ws.control))
+            {
+                R.labelIds.resize((size_t)spans.pixels);
+                int *out = R.labelIds.data();
+                forEachSpan(spans, 0, roiRect.height, ws.control, [&](int y, int x0, int x1)
+                {
+                    const float *Tp = tMap.ptr<float>(y);
+                    for (int x = x0; x < x1; ++x)
+                        *out++ = a.gmm.labelOf(Tp[x]);
+                });
+            }
+        }
+
+        bool statsFromHistogramApplies(const Params &p)
+        {
+            return p.statsOnly && !p.doBilateral && !p.superpixels && p.cdfMode == CdfMode::Histogram &&
+                   p.scoreSource != ScoreSource::LabExact;
+        }
+
+        int statsFromHistogram(const FrameView &in, const Params &p, const RoiSpans &spans, const Stripes &roiStripes,
+                               const std::vector<float> &thresholds, Workspace &ws, Result &R,
+                               const StageSink *sink, const ScoreKernel *kernelIn)
+        {
+            const cv::Rect roiRect = spans.rect;
+            const int bins = cdfBinsFor(p.cdfBins, spans.pixels);
+            Stripes stripes = roiStripes;
+            stripes.count = histogramStripes(stripes.count, bins, spans.pixels);
+            const ScoreKernel kernel = kernelIn ? *kernelIn : scoreKernel(p);
+            std::vector<std::vector<uint32_t>> &parts = ws.histParts;
+            parts.resize(stripes.count);
+            ws.rowBufs.resize(stripes.count);
+            ws.convBufs.resize(stripes.count);
+            parallelStripes(stripes, [&](int s, int y0, int y1)
+            {
+                std::vector<uint32_t> &h = parts[s];
+                h.assign(bins, 0);
+                std::vector<float> &row = ws.rowBufs[s];
+                row.resize(roiRect.width);
+                std::vector<uchar> &buf = ws.convBufs[s];
+                buf.resize((size_t)roiRect.width * 3);
+                forEachSpan(spans, y0, y1, ws.control, [&](int y, int x0, int x1)
+                {
+                    if (in.radiometric())
+                    {
+                        in.rawScoreRow(roiRect.y + y, roiRect.x + x0, roiRect.x + x1, true, row.data());
+                    }
+                    else
+                    {
+                        PixelLayout layout;
+                        const uchar *Sp = in.kernelRow(roiRect.y + y, roiRect.x + x0, roiRect.x + x1, buf.data(), layout);
+                        kernel(Sp, layout, row.data(), x1 - x0);
+                    }
+                    for (int x = 0; x < x1 - x0; ++x)
+                        h[scoreBin(row[x], bins)]++;
+                });
+            });
+            if (const int st = stopStatus(ws, R.message))
+            {
+                R.status = st;
+                return st;
+            }
+            std::vector<uint32_t> &hist = ws.hist;
+            mergeHistograms(parts, hist);
+            uint64_t nScores = 0;
+            for (uint32_t c : hist)
+                nScores += c;
+            if (nScores < 100)
+            {
+                R.status = -6;
+                R.message = "Too few pixels in ROI";
+                return R.status;
+            }
+            ScoreCdf &cdf = ws.cdf;
+            buildCdfHistogram(hist, nScores, cdf);
+            R.cdfError = cdf.maxError;
+            ScoreGmm &gmm = ws.gmm;
+            gmm.k = 0;
+            if (p.scoreGroups)
+            {
+                foldHistogram(hist, gmm.hist);
+                fitScoreGmm(gmm, (double)nScores, p.maxK, &cdf);
+            }
+
+            std::vector<int> &sel = ws.selCounts;
+            stageSelectedFromHistogram(hist, cdf, thresholds, sel);
+            R.stages.clear();
+            R.stages.reserve(thresholds.size());
+            for (size_t k = 0; k < thresholds.size(); ++k)
+            {
+                thermal::Payload payload;
+                payload.thresholdQ = thresholds[k];
+                payload.labelId = gmm.dominantAbove(thresholds[k]);
+                payload.mortarPermille = mortarPermille(sel[k], (int)nScores);
+                R.stages.emplace_back(std::move(payload));
+                if (sink && *sink && !(*sink)((int)k, R.stages.back()))
+                    break;
+            }
+            R.usedK = gmm.k;
+            return 0;
+        }
+
+    } // namespace detail
+} // namespace thermal
@@ -0,0 +1,116 @@
+#pragma once
+// Internal two-phase pipeline behind segmentTempGroups and Session (not installed).
+#include "thermal/core.hpp"
+#include "parallel.hpp"
+#include "roi.hpp"
+#include "workspace.hpp"
+#include "control.hpp"
+#include "frame.hpp"
+#include "superpixel.hpp"
+#include "score.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Image-dependent half of a call: everything up to the per-pixel ranks.
+        // The stage schedule (thresholding) only reads this.
+        struct StageRender;
+
+        struct Analysis
+        {
+            cv::Size frame;         // input size
+            RoiSpans spans;
+            Stripes stripes;
+            cv::Mat tMap;           // CV_32F, spans.rect size: score, then CDF rank per ROI pixel; 0 outside
+            cv::Mat tMapBuf;        // grow-only storage behind tMap
+            cv::Mat roiRgba;        // owned RGBA copy of spans.rect, shared by payloads (not copied)
+            const FrameView *source = nullptr;  // else the frame the ROI is converted from; both empty = no images
+            ScoreGmm gmm;           // score groups over the tMap values (Params::maxK)
+            Superpixels superpixels;    // Params::superpixels: superpixels of tMap; count 0 = off
+            float cdfError = 0.f;
+            bool open3x3 = false;   // per-stage opening (doBilateral)
+        };
+
+        // Points ws.control at ctl and pins the call's executor (ExecutorScope)
+        // for the lifetime of the scope
+        struct ControlScope
+        {
+            Workspace &ws;
+            ExecutorScope executor;
+            ControlScope(Workspace &w, const Control &ctl) : ws(w) { ws.control = &ctl; }
+            ~ControlScope() { ws.control = nullptr; }
+        };
+
+        // Strict range check of every Params field the pipeline reads (segmentTempGroups
+        // clamps instead). 0, or -2 with msg naming the field.
+        int validateParams(const Params &p, std::string &msg);
+
+        // Radiometric fields of p (rawGain, tempMin/tempMax, tempThresholds). 0, or -2 with msg.
+        int validateRadiometric(const Params &p, std::string &msg);
+
+        // Score source of p for color frames (Palette needs a palette; there is
+        // nothing to clamp it to). Checked on every path. 0, or -2 with msg.
+        int validateScoreSource(const Params &p, std::string &msg);
+
+        // Absolute-temperature stages apply: radiometric frame and p.tempThresholds set
+        inline bool absoluteStages(const FrameView &in, const Params &p)
+        {
+            return in.radiometric() && !p.tempThresholds.empty();
+        }
+
+        // p.tempThresholds (degrees) in score units of a radiometric frame
+        void absoluteThresholds(const Params &p, std::vector<float> &thresholds);
+
+        // Threshold schedule (ascending quantiles) for Params: branching methods based on refineMode
+        void stageThresholds(const Params &p, std::vector<float> &thresholds);
+
+        // Score and optional smoothing of in into a.tMap over a.spans.
+        // a.frame, a.spans and a.stripes must be set. kernel: p's row kernel
+        // picked once (a Plan's), null = scoreKernel(p).
+        void scoreMap(const FrameView &in, const Params &p, Analysis &a, Workspace &ws,
+                      const ScoreKernel *kernel = nullptr);
+
+        // bins-sized histogram of the a.tMap scores into ws.hist; returns the sample count
+        uint64_t scoreHistogram(const Analysis &a, int bins, Workspace &ws);
+
+        // Score groups are fitted only when something reads them
+        inline bool wantsGroups(const Params &p, bool needLabelIds)
+        {
+            return p.scoreGroups || (needLabelIds && !p.statsOnly);
+        }
+
+        // scoreMap, then CDF, score groups (if groups, else a.gmm.k = 0) and rank remap
+        // of a.tMap (absolute stages: scores only), then superpixels when
+        // p.superpixels is set.
+        // a.frame, a.spans and a.stripes must be set. 0 or a negative status + msg.
+        int analyze(const FrameView &in, const Params &p, Analysis &a, Workspace &ws, std::string &msg,
+                    bool groups, const ScoreKernel *kernel = nullptr);
+
+        // Stage map, per-stage counts and payloads for thresholds over an analysis.
+        // thresholds are compared against a.tMap; quantiles (default: thresholds)
+        // are what Payload::thresholdQ reports. sink (if non-empty) gets each stage
+        // as it is appended and may stop the loop.
+        // Payloads get images only if a.roiRgba or a.source is set and p.statsOnly is not.
+        // render is recycled (stage map and ROI copy buffers included) when no
+        // payload of an earlier result still holds it, otherwise replaced.
+        // needLabelIds fills R.labelIds from a.gmm (not with p.statsOnly).
+        // With a.superpixels stages are assigned per superpixel (its mean); p.drawEdges outlines them.
+        void stageResult(const Analysis &a, const std::vector<float> &thresholds, const Params &p, Workspace &ws,
+                         std::shared_ptr<StageRender> &render, Result &R,
+                         const std::vector<float> *quantiles = nullptr, const StageSink *sink = nullptr,
+                         bool needLabelIds = false);
+
+        // Stats-only histogram path applies (no score map needed)
+        bool statsFromHistogramApplies(const Params &p);
+
+        // Stage statistics straight from the score histogram, no score or stage map
+        int statsFromHistogram(const FrameView &in, const Params &p, const RoiSpans &spans, const Stripes &stripes,
+                               const std::vector<float> &thresholds, Workspace &ws, Result &R,
+                               const StageSink *sink = nullptr, const ScoreKernel *kernel = nullptr);
+
+    } // namespace detail
+} // namespace thermal
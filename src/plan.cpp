@@ -0,0 +1,60 @@
+#ifdef _WIN32
+#ifndef THERMAL_BUILD_DLL
+#define THERMAL_BUILD_DLL 1
+#endif
+#endif
+
+#include "thermal/core.hpp"
+#include "plan.hpp"
+
+namespace thermal
+{
+    THERMAL_API Plan::Plan(cv::Size frameSize, const std::optional<Polygon> &roi, const Params &p, bool needLabelIds)
+    {
+        try
+        {
+            if (frameSize.width <= 0 || frameSize.height <= 0)
+            {
+                status_ = -1;
+                message_ = "Frame size must be positive";
+                return;
+            }
+            status_ = detail::validateParams(p, message_);
+            if (status_ != 0)
+                return;
+
+            auto st = std::make_shared<detail::PlanState>();
+            st->frame = frameSize;
+            st->params = p;
+            st->needLabelIds = needLabelIds;
+            cv::Mat maskBuf;
+            detail::rasterizeRoi(roi, frameSize.width, frameSize.height, st->spans, maskBuf);
+            detail::stageThresholds(p, st->thresholds);
+            // score tables are built here, not on the first frame
+            st->kernel = detail::scoreKernel(st->params, /*warm=*/true);
+            st->statsPath = detail::statsFromHistogramApplies(p);
+            state_ = std::move(st);
+        }
+        catch (const cv::Exception &e)
+        {
+            status_ = -100;
+            message_ = e.what();
+        }
+    }
+
+    THERMAL_API int Plan::status() const
+    {
+        return status_;
+    }
+
+    THERMAL_API const std::string &Plan::message() const
+    {
+        return message_;
+    }
+
+    THERMAL_API cv::Size Plan::frameSize() const
+    {
+        return state_ ? state_->frame : cv::Size();
+    }
+
+} // namespace thermal
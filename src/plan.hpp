@@ -0,0 +1,21 @@
+#pragma once
+// Internal compiled form of thermal::Plan (not installed).
+#include "pipeline.hpp"
+#include "score.hpp"
+
+namespace thermal
+{
+    namespace detail
+    {
+        struct PlanState
+        {
+            cv::Size frame;
+            Params params;                  // validated
+            bool needLabelIds = false;
+            RoiSpans spans;                 // stripes are resolved per run (executor, cv::getNumThreads())
+            std::vector<float> thresholds;
+            ScoreKernel kernel;             // scoreKernel(params), tables built; reads params.palette
+            bool statsPath = false;         // statsFromHistogramApplies(params)
+        };
+    } // namespace detail
+} // namespace thermal
@@ -0,0 +1,212 @@
+#include "pool.hpp"
+#include <algorithm>
+#include <exception>
+
+namespace thermal
+{
+    namespace detail
+    {
+        static thread_local WorkStealingPool *tlPool = nullptr;
+        static thread_local int tlWorker = -1;
+
+        WorkStealingPool::WorkStealingPool(int numThreads)
+        {
+            const int n = std::max(1, numThreads);
+            for (int i = 0; i < n; ++i)
+                queues_.emplace_back(new Queue());
+            threads_.reserve(n);
+            for (int i = 0; i < n; ++i)
+                threads_.emplace_back([this, i] { loop(i); });
+        }
+
+        WorkStealingPool::~WorkStealingPool()
+        {
+            wait();
+            {
+                std::lock_guard<std::mutex> lk(m_);
+                stop_ = true;
+            }
+            work_.notify_all();
+            for (auto &t : threads_)
+                t.join();
+        }
+
+        WorkStealingPool *WorkStealingPool::current()
+        {
+            return tlPool;
+        }
+
+        void WorkStealingPool::push(int q, Job *job, std::function<void()> *tile)
+        {
+            pending_++;
+            {
+                std::lock_guard<std::mutex> lk(queues_[q]->m);
+                if (job)
+                    queues_[q]->jobs.push_back(std::move(*job));
+                else
+                    queues_[q]->tiles.push_back(std::move(*tile));
+            }
+            if (tile)
+                queuedTiles_++;
+            queued_++;
+            // empty critical section: a worker between its check and its wait sees the count
+            {
+                std::lock_guard<std::mutex> lk(m_);
+            }
+            work_.notify_one();
+            if (tile)
+                tiles_.notify_all();
+        }
+
+        void WorkStealingPool::submit(Job job)
+        {
+            const int q = (tlPool == this) ? tlWorker : (int)(next_++ % (unsigned)queues_.size());
+            push(q, &job, nullptr);
+        }
+
+        void WorkStealingPool::finished()
+        {
+            if (--pending_ == 0)
+            {
+                {
+                    std::lock_guard<std::mutex> lk(m_);
+                }
+                idle_.notify_all();
+            }
+        }
+
+        void WorkStealingPool::wakeTileWaiters()
+        {
+            {
+                std::lock_guard<std::mutex> lk(m_);
+            }
+            tiles_.notify_all();
+        }
+
+        bool WorkStealingPool::runTile(int self)
+        {
+            const int n = (int)queues_.size();
+            std::function<void()> tile;
+            for (int k = 0; k < n && !tile; ++k)
+            {
+                const int q = (self + k) % n;
+                std::lock_guard<std::mutex> lk(queues_[q]->m);
+                auto &d = queues_[q]->tiles;
+                if (d.empty())
+                    continue;
+                if (k == 0)
+                {
+                    tile = std::move(d.back());
+                    d.pop_back();
+                }
+                else
+                {
+                    tile = std::move(d.front());
+                    d.pop_front();
+                }
+            }
+            if (!tile)
+                return false;
+            queuedTiles_--;
+            queued_--;
+            tile();
+            finished();
+            return true;
+        }
+
+        bool WorkStealingPool::runJob(int self)
+        {
+            const int n = (int)queues_.size();
+            Job job;
+            for (int k = 0; k < n && !job; ++k)
+            {
+                const int q = (self + k) % n;
+                std::lock_guard<std::mutex> lk(queues_[q]->m);
+                auto &d = queues_[q]->jobs;
+                if (d.empty())
+                    continue;
+                // jobs stay FIFO so the submission order (largest first) holds
+                job = std::move(d.front());
+                d.pop_front();
+            }
+            if (!job)
+                return false;
+            queued_--;
+            job(self);
+            finished();
+            return true;
+        }
+
+        void WorkStealingPool::loop(int self)
+        {
+            tlPool = this;
+            tlWorker = self;
+            for (;;)
+            {
+                if (runTile(self) || runJob(self))
+                    continue;
+                std::unique_lock<std::mutex> lk(m_);
+                work_.wait(lk, [&] { return stop_ || queued_ > 0; });
+                if (stop_ && queued_ == 0)
+                    return;
+            }
+        }
+
+        void WorkStealingPool::wait()
+        {
+            std::unique_lock<std::mutex> lk(m_);
+            idle_.wait(lk, [&] { return pending_ == 0; });
+        }
+
+        void WorkStealingPool::parallelFor(int count, const std::function<void(int)> &fn)
+        {
+            if (count <= 0)
+                return;
+            if (tlPool != this || count == 1)
+            {
+                for (int i = 0; i < count; ++i)
+                    fn(i);
+                return;
+            }
+
+            std::atomic<int> left(count);
+            std::exception_ptr error;
+            std::mutex errorMutex;
+            auto runOne = [&](int i)
+            {
+                try
+                {
+                    fn(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lk(errorMutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+                // the waiter may return as soon as left hits 0: no captures after it
+                WorkStealingPool *pool = this;
+                if (--left == 0)
+                    pool->wakeTileWaiters();
+            };
+            for (int i = count - 1; i >= 1; --i)
+            {
+                std::function<void()> tile = [&runOne, i] { runOne(i); };
+                push(tlWorker, nullptr, &tile);
+            }
+            runOne(0);
+            // help with tiles (ours or other images') until ours are done; sleep
+            // while the rest of ours run elsewhere and nothing is queued
+            while (left > 0)
+            {
+                if (runTile(tlWorker))
+                    continue;
+                std::unique_lock<std::mutex> lk(m_);
+                tiles_.wait(lk, [&] { return left == 0 || queuedTiles_ > 0; });
+            }
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+    } // namespace detail
+} // namespace thermal
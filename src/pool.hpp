@@ -0,0 +1,75 @@
+#pragma once
+// Internal work-stealing thread pool for batch runs (not installed).
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Fixed set of workers with two deques each: jobs (whole images, FIFO) and
+        // tiles (row stripes of an image in flight; the owner pops the newest).
+        // Idle workers steal the oldest entry from the others. Tiles always go first, so
+        // images already started finish before new ones begin.
+        // A worker waiting on its own tiles (parallelFor) runs queued tiles
+        // while there are any, never jobs: per-worker state used by a job is
+        // not re-entered. Otherwise it sleeps until a tile is queued or its
+        // last tile finishes (queued jobs do not wake it).
+        class WorkStealingPool
+        {
+        public:
+            using Job = std::function<void(int worker)>;
+
+            explicit WorkStealingPool(int numThreads);
+            ~WorkStealingPool();    // waits for queued work, then joins
+
+            int size() const { return (int)threads_.size(); }
+
+            // Queue a job (round robin from outside the pool, own deque from a worker)
+            void submit(Job job);
+            // Block until every submitted job and tile has finished
+            void wait();
+
+            // fn(i) for i in [0, count). From a worker of this pool the tiles are
+            // spread over the pool and the caller helps; elsewhere runs inline.
+            // The first exception thrown by fn is rethrown after all tiles finished.
+            void parallelFor(int count, const std::function<void(int)> &fn);
+
+            // Pool of the calling worker thread, nullptr elsewhere
+            static WorkStealingPool *current();
+
+        private:
+            struct Queue
+            {
+                std::mutex m;
+                std::deque<Job> jobs;
+                std::deque<std::function<void()>> tiles;
+            };
+
+            void push(int q, Job *job, std::function<void()> *tile);
+            bool runTile(int self);
+            bool runJob(int self);
+            void loop(int self);
+            void finished();
+            void wakeTileWaiters();
+
+            std::vector<std::unique_ptr<Queue>> queues_;
+            std::vector<std::thread> threads_;
+            std::mutex m_;
+            std::condition_variable work_, idle_;
+            std::condition_variable tiles_;     // parallelFor waiters: a tile was queued or finished
+            std::atomic<int64_t> queued_{0};    // jobs and tiles in deques
+            std::atomic<int64_t> queuedTiles_{0};   // tiles in deques
+            std::atomic<int64_t> pending_{0};   // queued or running
+            std::atomic<unsigned> next_{0};
+            bool stop_ = false;
+        };
+
+    } // namespace detail
+} // namespace thermal
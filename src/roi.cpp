@@ -0,0 +1,89 @@
+#include "roi.hpp"
+#include "workspace.hpp"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+
+namespace thermal
+{
+    namespace detail
+    {
+        void RoiSpans::setRect(const cv::Rect &r)
+        {
+            rect = r;
+            rowStart.resize(r.height + 1);
+            spans.assign(r.height, cv::Vec2i(0, r.width));
+            for (int y = 0; y <= r.height; ++y)
+                rowStart[y] = y;
+            pixels = (int64_t)r.width * r.height;
+        }
+
+        void RoiSpans::setMask(const cv::Rect &r, const cv::Mat &mask)
+        {
+            rect = r;
+            rowStart.resize(r.height + 1);
+            spans.clear();
+            pixels = 0;
+            for (int y = 0; y < r.height; ++y)
+            {
+                rowStart[y] = (int)spans.size();
+                const uchar *Mp = mask.ptr<uchar>(y);
+                int x = 0;
+                while (x < r.width)
+                {
+                    while (x < r.width && !Mp[x])
+                        ++x;
+                    const int x0 = x;
+                    while (x < r.width && Mp[x])
+                        ++x;
+                    if (x > x0)
+                    {
+                        spans.emplace_back(x0, x);
+                        pixels += x - x0;
+                    }
+                }
+            }
+            rowStart[r.height] = (int)spans.size();
+        }
+
+        void RoiSpans::toMask(cv::Mat &mask) const
+        {
+            mask.create(rect.size(), CV_8UC1);
+            mask.setTo(cv::Scalar(0));
+            forEachSpan(*this, 0, rect.height, [&](int y, int x0, int x1)
+            {
+                std::fill(mask.ptr<uchar>(y) + x0, mask.ptr<uchar>(y) + x1, (uchar)255);
+            });
+        }
+
+        void rasterizeRoi(const std::optional<Polygon> &roi, int W, int H, RoiSpans &out, cv::Mat &maskBuf)
+        {
+            std::vector<cv::Point> &pts = out.poly;
+            pts.clear();
+            if (roi && !roi->xs.empty() && roi->xs.size() == roi->ys.size())
+            {
+                for (size_t i = 0; i < roi->xs.size(); ++i)
+                {
+                    int px = std::clamp(roi->xs[i], 0, W - 1);
+                    int py = std::clamp(roi->ys[i], 0, H - 1);
+                    pts.emplace_back(px, py);
+                }
+                const cv::Rect rect = cv::boundingRect(pts);
+
+                // If ROI is empty/abnormal, fallback to the entire ROI (if you want to return it as an error like before, return an error instead of the block below)
+                if (rect.width > 0 && rect.height > 0)
+                {
+                    cv::Mat mask = scratchMat(maskBuf, rect.size(), CV_8UC1);
+                    mask.setTo(cv::Scalar(0));
+                    const cv::Point *ppts[1] = {pts.data()};
+                    const int npts[1] = {(int)pts.size()};
+                    cv::fillPoly(mask, ppts, npts, 1, cv::Scalar(255), cv::LINE_8, 0, cv::Point(-rect.x, -rect.y));
+                    out.setMask(rect, mask);
+                    return;
+                }
+                pts.clear();
+            }
+            out.setRect(cv::Rect(0, 0, W, H));
+        }
+
+    } // namespace detail
+} // namespace thermal
@@ -0,0 +1,59 @@
+#pragma once
+// Internal span representation of the ROI (not installed).
+#include "thermal/core.hpp"
+#include "control.hpp"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // ROI as per-row [x0, x1) runs inside its bounding box
+        struct RoiSpans
+        {
+            cv::Rect rect;                  // bounding box in frame coords
+            std::vector<cv::Point> poly;    // clamped polygon; empty = whole frame
+            std::vector<int> rowStart;      // spans of row y: [rowStart[y], rowStart[y + 1])
+            std::vector<cv::Vec2i> spans;   // [x0, x1), relative to rect.x
+            int64_t pixels = 0;
+
+            int rows() const { return rect.height; }
+            const cv::Vec2i *rowBegin(int y) const { return spans.data() + rowStart[y]; }
+            const cv::Vec2i *rowEnd(int y) const { return spans.data() + rowStart[y + 1]; }
+
+            // One full-width span per row
+            void setRect(const cv::Rect &r);
+            // Runs of non-zero pixels of a CV_8UC1 mask of rect size
+            void setMask(const cv::Rect &r, const cv::Mat &mask);
+            // Materialize as a rect-sized 0/255 mask (for filters that need one)
+            void toMask(cv::Mat &mask) const;
+        };
+
+        // Polygon (clamped to the frame) -> spans. Coverage is identical to the
+        // previous cv::fillPoly rasterization; only a bounding-box-sized scratch
+        // mask (maskBuf, grow-only) is used, and none at all without a polygon.
+        void rasterizeRoi(const std::optional<Polygon> &roi, int W, int H, RoiSpans &out, cv::Mat &maskBuf);
+
+        // fn(y, x0, x1) for every span of rows [y0, y1); rows stop early once ctl says so
+        template <typename Fn>
+        inline void forEachSpan(const RoiSpans &S, int y0, int y1, const Control *ctl, Fn &&fn)
+        {
+            for (int y = y0; y < y1; ++y)
+            {
+                if (stopRequested(ctl))
+                    return;
+                for (const cv::Vec2i *s = S.rowBegin(y), *e = S.rowEnd(y); s != e; ++s)
+                    fn(y, (*s)[0], (*s)[1]);
+            }
+        }
+
+        template <typename Fn>
+        inline void forEachSpan(const RoiSpans &S, int y0, int y1, Fn &&fn)
+        {
+            forEachSpan(S, y0, y1, nullptr, std::forward<Fn>(fn));
+        }
+
+    } // namespace detail
+} // namespace thermal
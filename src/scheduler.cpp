@@ -0,0 +1,297 @@
+#ifdef _WIN32
+#ifndef THERMAL_BUILD_DLL
+#define THERMAL_BUILD_DLL 1
+#endif
+#endif
+
+#include "thermal/core.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace thermal
+{
+    namespace detail
+    {
+        struct ScheduledRequest
+        {
+            cv::Mat image;                      // owned copy
+            std::optional<Polygon> roi;
+            Params params;
+            ResultCallback done;
+            bool needLabelIds = false;
+        };
+
+        struct RunningRequest
+        {
+            std::shared_ptr<CancelToken> token;
+            bool superseded = false;            // result is discarded
+        };
+
+        struct SchedulerState
+        {
+            mutable std::mutex mutex;
+            std::condition_variable work;       // a key became runnable, or stop
+            std::condition_variable idle;       // a request finished
+            std::deque<uint64_t> order;         // keys with a queued request, oldest first
+            std::unordered_map<uint64_t, ScheduledRequest> queued;
+            std::unordered_map<uint64_t, RunningRequest> running;
+            SchedulerStats stats;
+            int delivering = 0;                 // callbacks running now
+            bool stop = false;
+            int maxWorkers = 1;
+            std::vector<std::thread> workers;   // own threads (no executor with post)
+            std::shared_ptr<Executor> ex;       // posts the workers, or null
+            int posted = 0;                     // executor workers posted and not yet returned
+            std::vector<std::unique_ptr<Engine>> engines;   // idle engines of executor workers
+
+            // First queued key whose previous request is not still running
+            bool takeRunnable(uint64_t &key, ScheduledRequest &req)
+            {
+                for (auto it = order.begin(); it != order.end(); ++it)
+                {
+                    if (running.count(*it))
+                        continue;
+                    key = *it;
+                    order.erase(it);
+                    auto q = queued.find(key);
+                    req = std::move(q->second);
+                    queued.erase(q);
+                    return true;
+                }
+                return false;
+            }
+
+            void abandon(RunningRequest &r)
+            {
+                if (r.superseded)
+                    return;
+                r.token->cancel();
+                r.superseded = true;
+                stats.abandoned++;
+            }
+
+            // Run one taken request; lk is held on entry and on return
+            void runRequest(std::unique_lock<std::mutex> &lk, Engine &engine, uint64_t key, ScheduledRequest &req)
+            {
+                RunningRequest &r = running[key];
+                r.token = std::make_shared<CancelToken>();
+                req.params.cancel = r.token;
+                lk.unlock();
+
+                Result R = engine.run(req.image, req.roi, req.params, req.needLabelIds);
+                req.image.release();
+
+                lk.lock();
+                auto it = running.find(key);
+                const bool deliver = !it->second.superseded;
+                running.erase(it);
+                if (deliver)
+                    stats.completed++;
+                // a newer request of this key may now start
+                work.notify_all();
+                if (deliver && req.done)
+                {
+                    delivering++;
+                    lk.unlock();
+                    req.done(std::move(R));
+                    lk.lock();
+                    delivering--;
+                }
+                idle.notify_all();
+            }
+
+            // Own thread: waits for work until stop
+            void workerLoop()
+            {
+                Engine engine;
+                std::unique_lock<std::mutex> lk(mutex);
+                for (;;)
+                {
+                    uint64_t key = 0;
+                    ScheduledRequest req;
+                    work.wait(lk, [&] { return stop || takeRunnable(key, req); });
+                    if (stop)
+                        return;
+                    runRequest(lk, engine, key, req);
+                }
+            }
+
+            // Executor task: runs requests while any is runnable, then returns.
+            // A request turns runnable either in submit, which posts a worker
+            // below maxWorkers, or when one finishes here, so none is left behind.
+            void executorWorker()
+            {
+                std::unique_lock<std::mutex> lk(mutex);
+                std::unique_ptr<Engine> engine;
+                if (!engines.empty())
+                {
+                    engine = std::move(engines.back());
+                    engines.pop_back();
+                }
+                else
+                {
+                    engine.reset(new Engine());
+                }
+                for (;;)
+                {
+                    uint64_t key = 0;
+                    ScheduledRequest req;
+                    if (stop || !takeRunnable(key, req))
+                        break;
+                    runRequest(lk, *engine, key, req);
+                }
+                engines.push_back(std::move(engine));
+                // last touch of the state: the destructor waits for posted == 0
+                posted--;
+                idle.notify_all();
+            }
+
+            // Start a worker for newly runnable work: a posted executor task, or
+            // the own threads if the executor turns out not to support post.
+            // Called without the lock.
+            void wake()
+            {
+                std::shared_ptr<Executor> e;
+                {
+                    std::lock_guard<std::mutex> lk(mutex);
+                    if (ex)
+                    {
+                        if (stop || posted >= maxWorkers)
+                            return;
+                        posted++;
+                        e = ex;
+                    }
+                }
+                if (!e)
+                {
+                    work.notify_one();
+                    return;
+                }
+                if (e->post([this] { executorWorker(); }))
+                    return;
+                std::lock_guard<std::mutex> lk(mutex);
+                posted--;
+                if (ex)
+                {
+                    ex.reset();
+                    startThreads();
+                }
+                work.notify_all();
+            }
+
+            void startThreads()
+            {
+                for (int i = 0; i < maxWorkers; ++i)
+                    workers.emplace_back([this] { workerLoop(); });
+            }
+        };
+    } // namespace detail
+
+    THERMAL_API Scheduler::Scheduler(int numWorkers)
+        : state_(new detail::SchedulerState())
+    {
+        detail::SchedulerState &S = *state_;
+        S.maxWorkers = std::max(1, numWorkers);
+        S.ex = detail::installedExecutor();
+        if (!S.ex)
+            S.startThreads();
+    }
+
+    THERMAL_API Scheduler::~Scheduler()
+    {
+        detail::SchedulerState &S = *state_;
+        {
+            std::lock_guard<std::mutex> lk(S.mutex);
+            S.stop = true;
+            S.stats.dropped += S.queued.size();
+            S.queued.clear();
+            S.order.clear();
+            for (auto &kv : S.running)
+                S.abandon(kv.second);
+        }
+        S.work.notify_all();
+        {
+            std::unique_lock<std::mutex> lk(S.mutex);
+            S.idle.wait(lk, [&] { return S.posted == 0; });
+        }
+        for (std::thread &t : S.workers)
+            t.join();
+    }
+
+    THERMAL_API void Scheduler::submit(uint64_t key,
+                                       const cv::Mat &inRgba,
+                                       const std::optional<Polygon> &roi,
+                                       const Params &p,
+                                       ResultCallback done,
+                                       bool needLabelIds)
+    {
+        detail::ScheduledRequest req;
+        req.image = inRgba.clone();
+        req.roi = roi;
+        req.params = p;
+        req.done = std::move(done);
+        req.needLabelIds = needLabelIds;
+
+        detail::SchedulerState &S = *state_;
+        {
+            std::lock_guard<std::mutex> lk(S.mutex);
+            if (S.stop)
+                return;
+            S.stats.submitted++;
+            auto q = S.queued.find(key);
+            if (q != S.queued.end())
+            {
+                // keeps the key's place in line
+                q->second = std::move(req);
+                S.stats.dropped++;
+            }
+            else
+            {
+                S.queued.emplace(key, std::move(req));
+                S.order.push_back(key);
+            }
+            auto r = S.running.find(key);
+            if (r != S.running.end())
+                S.abandon(r->second);
+        }
+        S.wake();
+    }
+
+    THERMAL_API void Scheduler::cancel(uint64_t key)
+    {
+        detail::SchedulerState &S = *state_;
+        std::lock_guard<std::mutex> lk(S.mutex);
+        if (S.queued.erase(key))
+        {
+            S.order.erase(std::find(S.order.begin(), S.order.end(), key));
+            S.stats.dropped++;
+        }
+        auto r = S.running.find(key);
+        if (r != S.running.end())
+            S.abandon(r->second);
+        S.idle.notify_all();
+    }
+
+    THERMAL_API void Scheduler::wait()
+    {
+        detail::SchedulerState &S = *state_;
+        std::unique_lock<std::mutex> lk(S.mutex);
+        S.idle.wait(lk, [&] { return S.queued.empty() && S.running.empty() && S.delivering == 0; });
+    }
+
+    THERMAL_API SchedulerStats Scheduler::stats() const
+    {
+        const detail::SchedulerState &S = *state_;
+        std::lock_guard<std::mutex> lk(S.mutex);
+        SchedulerStats st = S.stats;
+        st.queueDepth = (int)S.queued.size();
+        st.inFlight = (int)S.running.size();
+        return st;
+    }
+
+} // namespace thermal
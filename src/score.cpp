@@ -0,0 +1,367 @@
+#ifdef _WIN32
+#ifndef THERMAL_BUILD_DLL
+#define THERMAL_BUILD_DLL 1
+#endif
+#endif
+
+#include "score.hpp"
+#include "palette.hpp"
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define THERMAL_SCORE_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Pixels per kernel block (one AVX2 vector, two SSE/NEON vectors)
+        static constexpr int BLK = 8;
+        // Cube-root table resolution over t in [0, 1]
+        static constexpr int CBRT_N = 4096;
+
+        // sRGB -> XYZ (D65), rows pre-divided by the white point like OpenCV
+        static constexpr float M00 = 0.412453f / 0.950456f, M01 = 0.357580f / 0.950456f, M02 = 0.180423f / 0.950456f;
+        static constexpr float M10 = 0.212671f, M11 = 0.715160f, M12 = 0.072169f;
+        static constexpr float M20 = 0.019334f / 1.088754f, M21 = 0.119193f / 1.088754f, M22 = 0.950227f / 1.088754f;
+
+        struct ScoreTables
+        {
+            float lin[256];              // 8-bit sRGB -> linear
+            float fTab[CBRT_N + 1];      // Lab f(t) at t = i/CBRT_N
+            float fDif[CBRT_N + 1];      // fTab[i+1] - fTab[i]
+        };
+
+        static const ScoreTables &scoreTables()
+        {
+            static const ScoreTables T = []
+            {
+                ScoreTables t{};
+                for (int i = 0; i < 256; ++i)
+                {
+                    double x = i / 255.0;
+                    t.lin[i] = (float)(x <= 0.04045 ? x / 12.92 : std::pow((x + 0.055) / 1.055, 2.4));
+                }
+                for (int i = 0; i <= CBRT_N; ++i)
+                {
+                    double v = (double)i / CBRT_N;
+                    t.fTab[i] = (float)(v > 0.008856 ? std::cbrt(v) : 7.787 * v + 16.0 / 116.0);
+                }
+                for (int i = 0; i < CBRT_N; ++i)
+                    t.fDif[i] = t.fTab[i + 1] - t.fTab[i];
+                t.fDif[CBRT_N] = 0.f;
+                return t;
+            }();
+            return T;
+        }
+
+        // Linearized channels of one block, SoA
+        struct Block
+        {
+            alignas(32) float r[BLK];
+            alignas(32) float g[BLK];
+            alignas(32) float b[BLK];
+        };
+
+        static inline void gather(const uchar *src, PixelLayout layout, int n, const float *lin, Block &B)
+        {
+            if (layout == PixelLayout::RGBA)
+            {
+                for (int i = 0; i < n; ++i, src += 4)
+                {
+                    B.r[i] = lin[src[0]];
+                    B.g[i] = lin[src[1]];
+                    B.b[i] = lin[src[2]];
+                }
+            }
+            else if (layout == PixelLayout::Gray)
+            {
+                for (int i = 0; i < n; ++i, ++src)
+                    B.r[i] = B.g[i] = B.b[i] = lin[src[0]];
+            }
+            else
+            {
+                const int cn = layoutChannels(layout);
+                for (int i = 0; i < n; ++i, src += cn)
+                {
+                    B.b[i] = lin[src[0]];
+                    B.g[i] = lin[src[1]];
+                    B.r[i] = lin[src[2]];
+                }
+            }
+            for (int i = n; i < BLK; ++i)
+                B.r[i] = B.g[i] = B.b[i] = 0.f;
+        }
+
+#if defined(__AVX2__)
+        static inline __m256 labF(__m256 t, const ScoreTables &T)
+        {
+            const __m256 scale = _mm256_set1_ps((float)CBRT_N);
+            t = _mm256_min_ps(_mm256_max_ps(t, _mm256_setzero_ps()), _mm256_set1_ps(1.f));
+            __m256 pos = _mm256_mul_ps(t, scale);
+            __m256i idx = _mm256_cvttps_epi32(pos);
+            __m256 frac = _mm256_sub_ps(pos, _mm256_cvtepi32_ps(idx));
+            __m256 f0 = _mm256_i32gather_ps(T.fTab, idx, 4);
+            __m256 df = _mm256_i32gather_ps(T.fDif, idx, 4);
+            return _mm256_add_ps(f0, _mm256_mul_ps(frac, df));
+        }
+
+        static inline void scoreBlock(const Block &B, const ScoreTables &T, float *out)
+        {
+            const __m256 r = _mm256_load_ps(B.r), g = _mm256_load_ps(B.g), b = _mm256_load_ps(B.b);
+            auto dot = [&](float c0, float c1, float c2)
+            {
+                return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r, _mm256_set1_ps(c0)),
+                                                   _mm256_mul_ps(g, _mm256_set1_ps(c1))),
+                                     _mm256_mul_ps(b, _mm256_set1_ps(c2)));
+            };
+            const __m256 fx = labF(dot(M00, M01, M02), T);
+            const __m256 fy = labF(dot(M10, M11, M12), T);
+            const __m256 fz = labF(dot(M20, M21, M22), T);
+            const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.f);
+
+            __m256 L = _mm256_sub_ps(_mm256_mul_ps(fy, _mm256_set1_ps(116.f / 100.f)), _mm256_set1_ps(16.f / 100.f));
+            L = _mm256_min_ps(_mm256_max_ps(L, zero), one);
+            __m256 a = _mm256_mul_ps(_mm256_sub_ps(fx, fy), _mm256_set1_ps(500.f));
+            __m256 c = _mm256_mul_ps(_mm256_sub_ps(fy, fz), _mm256_set1_ps(200.f));
+            __m256 C = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(c, c)));
+            C = _mm256_min_ps(_mm256_mul_ps(C, _mm256_set1_ps(1.f / CHROMA_NORM)), one);
+            __m256 s = _mm256_add_ps(_mm256_mul_ps(L, _mm256_set1_ps(W_L)),
+                                     _mm256_mul_ps(_mm256_sub_ps(one, C), _mm256_set1_ps(W_W)));
+            _mm256_storeu_ps(out, s);
+        }
+#else
+        // Table lookups for targets without a gather instruction
+        static inline void labFIndex(const float *t, float *f, const ScoreTables &T)
+        {
+            for (int i = 0; i < BLK; ++i)
+            {
+                float v = std::min(std::max(t[i], 0.f), 1.f) * (float)CBRT_N;
+                int k = (int)v;
+                f[i] = T.fTab[k] + (v - (float)k) * T.fDif[k];
+            }
+        }
+
+#if defined(THERMAL_SCORE_SSE2)
+        static inline void scoreBlock(const Block &B, const ScoreTables &T, float *out)
+        {
+            alignas(16) float tx[BLK], ty[BLK], tz[BLK];
+            for (int h = 0; h < BLK; h += 4)
+            {
+                const __m128 r = _mm_load_ps(B.r + h), g = _mm_load_ps(B.g + h), b = _mm_load_ps(B.b + h);
+                auto dot = [&](float c0, float c1, float c2)
+                {
+                    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(c0)), _mm_mul_ps(g, _mm_set1_ps(c1))),
+                                      _mm_mul_ps(b, _mm_set1_ps(c2)));
+                };
+                _mm_store_ps(tx + h, dot(M00, M01, M02));
+                _mm_store_ps(ty + h, dot(M10, M11, M12));
+                _mm_store_ps(tz + h, dot(M20, M21, M22));
+            }
+            labFIndex(tx, tx, T);
+            labFIndex(ty, ty, T);
+            labFIndex(tz, tz, T);
+            const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f);
+            for (int h = 0; h < BLK; h += 4)
+            {
+                const __m128 fx = _mm_load_ps(tx + h), fy = _mm_load_ps(ty + h), fz = _mm_load_ps(tz + h);
+                __m128 L = _mm_sub_ps(_mm_mul_ps(fy, _mm_set1_ps(116.f / 100.f)), _mm_set1_ps(16.f / 100.f));
+                L = _mm_min_ps(_mm_max_ps(L, zero), one);
+                __m128 a = _mm_mul_ps(_mm_sub_ps(fx, fy), _mm_set1_ps(500.f));
+                __m128 c = _mm_mul_ps(_mm_sub_ps(fy, fz), _mm_set1_ps(200.f));
+                __m128 C = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(c, c)));
+                C = _mm_min_ps(_mm_mul_ps(C, _mm_set1_ps(1.f / CHROMA_NORM)), one);
+                __m128 s = _mm_add_ps(_mm_mul_ps(L, _mm_set1_ps(W_L)),
+                                      _mm_mul_ps(_mm_sub_ps(one, C), _mm_set1_ps(W_W)));
+                _mm_storeu_ps(out + h, s);
+            }
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        static inline void scoreBlock(const Block &B, const ScoreTables &T, float *out)
+        {
+            alignas(16) float tx[BLK], ty[BLK], tz[BLK];
+            for (int h = 0; h < BLK; h += 4)
+            {
+                const float32x4_t r = vld1q_f32(B.r + h), g = vld1q_f32(B.g + h), b = vld1q_f32(B.b + h);
+                auto dot = [&](float c0, float c1, float c2)
+                {
+                    return vaddq_f32(vaddq_f32(vmulq_n_f32(r, c0), vmulq_n_f32(g, c1)), vmulq_n_f32(b, c2));
+                };
+                vst1q_f32(tx + h, dot(M00, M01, M02));
+                vst1q_f32(ty + h, dot(M10, M11, M12));
+                vst1q_f32(tz + h, dot(M20, M21, M22));
+            }
+            labFIndex(tx, tx, T);
+            labFIndex(ty, ty, T);
+            labFIndex(tz, tz, T);
+            const float32x4_t zero = vdupq_n_f32(0.f), one = vdupq_n_f32(1.f);
+            for (int h = 0; h < BLK; h += 4)
+            {
+                const float32x4_t fx = vld1q_f32(tx + h), fy = vld1q_f32(ty + h), fz = vld1q_f32(tz + h);
+                float32x4_t L = vsubq_f32(vmulq_n_f32(fy, 116.f / 100.f), vdupq_n_f32(16.f / 100.f));
+                L = vminq_f32(vmaxq_f32(L, zero), one);
+                float32x4_t a = vmulq_n_f32(vsubq_f32(fx, fy), 500.f);
+                float32x4_t c = vmulq_n_f32(vsubq_f32(fy, fz), 200.f);
+                float32x4_t C = vsqrtq_f32(vaddq_f32(vmulq_f32(a, a), vmulq_f32(c, c)));
+                C = vminq_f32(vmulq_n_f32(C, 1.f / CHROMA_NORM), one);
+                float32x4_t s = vaddq_f32(vmulq_n_f32(L, W_L), vmulq_n_f32(vsubq_f32(one, C), W_W));
+                vst1q_f32(out + h, s);
+            }
+        }
+#else
+        static inline void scoreBlock(const Block &B, const ScoreTables &T, float *out)
+        {
+            float tx[BLK], ty[BLK], tz[BLK];
+            for (int i = 0; i < BLK; ++i)
+            {
+                tx[i] = B.r[i] * M00 + B.g[i] * M01 + B.b[i] * M02;
+                ty[i] = B.r[i] * M10 + B.g[i] * M11 + B.b[i] * M12;
+                tz[i] = B.r[i] * M20 + B.g[i] * M21 + B.b[i] * M22;
+            }
+            labFIndex(tx, tx, T);
+            labFIndex(ty, ty, T);
+            labFIndex(tz, tz, T);
+            for (int i = 0; i < BLK; ++i)
+            {
+                float L = std::min(std::max(ty[i] * (116.f / 100.f) - 16.f / 100.f, 0.f), 1.f);
+                float a = (tx[i] - ty[i]) * 500.f;
+                float c = (ty[i] - tz[i]) * 200.f;
+                float C = std::min(std::sqrt(a * a + c * c) * (1.f / CHROMA_NORM), 1.f);
+                out[i] = L * W_L + (1.f - C) * W_W;
+            }
+        }
+#endif
+#endif
+
+        void scoreRow(const uchar *src, PixelLayout layout, float *dst, int n)
+        {
+            const ScoreTables &T = scoreTables();
+            const int cn = layoutChannels(layout);
+            Block B;
+            int x = 0;
+            for (; x + BLK <= n; x += BLK)
+            {
+                gather(src + x * cn, layout, BLK, T.lin, B);
+                scoreBlock(B, T, dst + x);
+            }
+            if (x < n)
+            {
+                // Tail goes through the same block math so every pixel gets identical results
+                alignas(32) float tail[BLK];
+                gather(src + x * cn, layout, n - x, T.lin, B);
+                scoreBlock(B, T, tail);
+                std::memcpy(dst + x, tail, sizeof(float) * (size_t)(n - x));
+            }
+        }
+
+        // Exact double-precision score of one sRGB color (components in 0..1; may exceed 1)
+        static float scoreExact(double R, double G, double B)
+        {
+            auto lin = [](double x)
+            { return x <= 0.04045 ? x / 12.92 : std::pow((x + 0.055) / 1.055, 2.4); };
+            auto f = [](double t)
+            { return t > 0.008856 ? std::cbrt(t) : 7.787 * t + 16.0 / 116.0; };
+            const double r = lin(R), g = lin(G), b = lin(B);
+            const double X = (0.412453 * r + 0.357580 * g + 0.180423 * b) / 0.950456;
+            const double Y = 0.212671 * r + 0.715160 * g + 0.072169 * b;
+            const double Z = (0.019334 * r + 0.119193 * g + 0.950227 * b) / 1.088754;
+            const double L = Y > 0.008856 ? 116.0 * std::cbrt(Y) - 16.0 : 903.3 * Y;
+            return scoreFromLab((float)L, (float)(500.0 * (f(X) - f(Y))), (float)(200.0 * (f(Y) - f(Z))));
+        }
+
+        static constexpr int LUT3_SHIFT = 2;                    // 8-bit value >> 2 -> cell
+        static constexpr int LUT3_N = (256 >> LUT3_SHIFT) + 1;  // nodes per axis
+
+        static const std::vector<float> &lut3D()
+        {
+            static const std::vector<float> T = []
+            {
+                std::vector<float> t((size_t)LUT3_N * LUT3_N * LUT3_N);
+                const int step = 1 << LUT3_SHIFT;
+                for (int i = 0; i < LUT3_N; ++i)
+                    for (int j = 0; j < LUT3_N; ++j)
+                        for (int k = 0; k < LUT3_N; ++k)
+                            t[((size_t)i * LUT3_N + j) * LUT3_N + k] =
+                                scoreExact(i * step / 255.0, j * step / 255.0, k * step / 255.0);
+                return t;
+            }();
+            return T;
+        }
+
+        static inline float lut3DPixel(const float *T, int R, int G, int B)
+        {
+            constexpr int M = (1 << LUT3_SHIFT) - 1;
+            constexpr float INV = 1.f / (float)(1 << LUT3_SHIFT);
+            constexpr int SR = LUT3_N * LUT3_N, SG = LUT3_N;
+            const float *c = T + (R >> LUT3_SHIFT) * SR + (G >> LUT3_SHIFT) * SG + (B >> LUT3_SHIFT);
+            const float fr = (float)(R & M) * INV, fg = (float)(G & M) * INV, fb = (float)(B & M) * INV;
+            const float c00 = c[0] + fb * (c[1] - c[0]);
+            const float c01 = c[SG] + fb * (c[SG + 1] - c[SG]);
+            const float c10 = c[SR] + fb * (c[SR + 1] - c[SR]);
+            const float c11 = c[SR + SG] + fb * (c[SR + SG + 1] - c[SR + SG]);
+            const float c0 = c00 + fg * (c01 - c00);
+            const float c1 = c10 + fg * (c11 - c10);
+            return c0 + fr * (c1 - c0);
+        }
+
+        void scoreRowLut3D(const uchar *src, PixelLayout layout, float *dst, int n)
+        {
+            const float *T = lut3D().data();
+            if (layout == PixelLayout::RGBA)
+            {
+                for (int x = 0; x < n; ++x, src += 4)
+                    dst[x] = lut3DPixel(T, src[0], src[1], src[2]);
+            }
+            else if (layout == PixelLayout::Gray)
+            {
+                for (int x = 0; x < n; ++x, ++src)
+                    dst[x] = lut3DPixel(T, src[0], src[0], src[0]);
+            }
+            else
+            {
+                const int cn = layoutChannels(layout);
+                for (int x = 0; x < n; ++x, src += cn)
+                    dst[x] = lut3DPixel(T, src[2], src[1], src[0]);
+            }
+        }
+
+        ScoreKernel scoreKernel(const Params &p, bool warm)
+        {
+            ScoreKernel k;
+            switch (p.scoreSource)
+            {
+            case ScoreSource::Palette:
+                if (const PaletteLut *T = PaletteAccess::lut(p.palette))
+                {
+                    k.fn = [](const void *t, const uchar *src, PixelLayout layout, float *dst, int n)
+                    { scoreRowPalette(*static_cast<const PaletteLut *>(t), src, layout, dst, n); };
+                    k.table = T;
+                    return k;
+                }
+                [[fallthrough]];
+            case ScoreSource::Fused:
+                if (warm)
+                    (void)scoreTables();
+                k.fn = [](const void *, const uchar *src, PixelLayout layout, float *dst, int n)
+                { scoreRow(src, layout, dst, n); };
+                return k;
+            case ScoreSource::Lut3D:
+                if (warm)
+                    (void)lut3D();
+                k.fn = [](const void *, const uchar *src, PixelLayout layout, float *dst, int n)
+                { scoreRowLut3D(src, layout, dst, n); };
+                return k;
+            default:
+                return k;
+            }
+        }
+
+    } // namespace detail
+} // namespace thermal
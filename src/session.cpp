@@ -0,0 +1,88 @@
+#ifdef _WIN32
+#ifndef THERMAL_BUILD_DLL
+#define THERMAL_BUILD_DLL 1
+#endif
+#endif
+
+#include "thermal/core.hpp"
+#include "pipeline.hpp"
+#include "payload.hpp"
+
+namespace thermal
+{
+    THERMAL_API Session::Session(const cv::Mat &inRgba, const std::optional<Polygon> &roi, const Params &p)
+    {
+        try
+        {
+            if (inRgba.empty() || inRgba.type() != CV_8UC4)
+            {
+                status_ = -1;
+                message_ = "Input must be CV_8UC4 RGBA";
+                return;
+            }
+            status_ = detail::validateScoreSource(p, message_);
+            if (status_ != 0)
+                return;
+            detail::Workspace ws;
+            const detail::Control ctl(p);
+            const detail::ControlScope scope(ws, ctl);
+            auto a = std::make_shared<detail::Analysis>();
+            a->frame = inRgba.size();
+            detail::rasterizeRoi(roi, inRgba.cols, inRgba.rows, a->spans, ws.maskBuf);
+            a->stripes = detail::Stripes(a->spans.rect.size(), p.numThreads);
+            // owned copy: the caller's frame may be reused after construction
+            a->roiRgba = inRgba(a->spans.rect).clone();
+            status_ = detail::analyze(detail::FrameView::fromRgba(inRgba), p, *a, ws, message_, p.scoreGroups);
+            if (status_ == 0)
+                analysis_ = std::move(a);
+        }
+        catch (const cv::Exception &e)
+        {
+            status_ = -100;
+            message_ = e.what();
+        }
+    }
+
+    THERMAL_API int Session::status() const
+    {
+        return status_;
+    }
+
+    THERMAL_API const std::string &Session::message() const
+    {
+        return message_;
+    }
+
+    THERMAL_API Result Session::run(const Params &p, bool needLabelIds) const
+    {
+        return run(p, StageSink(), needLabelIds);
+    }
+
+    THERMAL_API Result Session::run(const Params &p, const StageSink &onStage, bool needLabelIds) const
+    {
+        Result R;
+        if (!analysis_)
+        {
+            R.status = status_ != 0 ? status_ : -1;
+            R.message = message_;
+            return R;
+        }
+        try
+        {
+            detail::Workspace ws;
+            const detail::Control ctl(p);
+            const detail::ControlScope scope(ws, ctl);
+            std::shared_ptr<detail::StageRender> render;
+            detail::stageThresholds(p, ws.thresholds);
+            detail::stageResult(*analysis_, ws.thresholds, p, ws, render, R, nullptr, &onStage, needLabelIds);
+            detail::applyStop(ctl, R);
+        }
+        catch (const cv::Exception &e)
+        {
+            R.status = -100;
+            R.message = e.what();
+        }
+        return R;
+    }
+
+} // namespace thermal
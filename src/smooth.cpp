@@ -0,0 +1,288 @@
+#include "smooth.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+
+namespace thermal
+{
+    namespace detail
+    {
+        namespace
+        {
+            // Box sums in O(1) per pixel whatever the radius. Each axis is cut into
+            // blocks of at least w = 2r + 1 starting at 0 (w rows; a power of two >= 64
+            // columns, so row loops stay long) and summed by prefixes that restart on
+            // every block, so a (clipped) window, which meets at most two blocks, is
+            // a sum or difference of at most three prefixes. The prefixes never run
+            // past a block (no cancellation over long runs) and start at fixed
+            // boundaries, so a window's sum does not depend on the stripe computing
+            // it (bit-identical for any thread count).
+
+            // Block prefixes P along one row of N planes, and D[x] = P[end of x's
+            // block] - P[x], the block's sum past x. Four blocks advance together
+            // so the 4N running sums are independent chains.
+            template <int N>
+            void rowPrefixes(const float *in, float *P, float *D, int cols, int block)
+            {
+                const int full = cols / block;
+                int b = 0;
+                for (; b + 4 <= full; b += 4)
+                {
+                    float acc[4][N] = {};
+                    for (int k = 0; k < block; ++k)
+                        for (int j = 0; j < 4; ++j)
+                            for (int c = 0; c < N; ++c)
+                            {
+                                const int x = (b + j) * block + k;
+                                P[c * cols + x] = acc[j][c] += in[c * cols + x];
+                            }
+                    for (int c = 0; c < N; ++c)
+                        for (int j = 0; j < 4; ++j)
+                            for (int x = (b + j) * block, e = x + block; x < e; ++x)
+                                D[c * cols + x] = acc[j][c] - P[c * cols + x];
+                }
+                for (int x0 = b * block; x0 < cols; x0 += block)
+                {
+                    const int e = std::min(cols, x0 + block);
+                    float acc[N] = {};
+                    for (int x = x0; x < e; ++x)
+                        for (int c = 0; c < N; ++c)
+                            P[c * cols + x] = acc[c] += in[c * cols + x];
+                    for (int c = 0; c < N; ++c)
+                        for (int x = x0; x < e; ++x)
+                            D[c * cols + x] = acc[c] - P[c * cols + x];
+                }
+            }
+
+            // Window sums of one row from its block prefixes (blocks of block >= w =
+            // 2r + 1 columns, a power of two): P[hi] while the window starts at
+            // column 0, else P[hi] - P[lo - 1] when lo - 1 and hi share a block and
+            // P[hi] + D[lo - 1] when they fall in consecutive ones
+            void rowWindows(const float *P, const float *D, float *out, int cols, int r, int block)
+            {
+                const int w = 2 * r + 1, head = std::min(r + 1, cols), body = std::max(cols - r, head);
+                for (int x = 0; x < head; ++x)
+                    out[x] = P[std::min(x + r, cols - 1)];
+                // hi runs block by block: its first w columns take D, the rest -P
+                for (int x = head; x < body;)
+                {
+                    const int hi = x + r, split = std::min((hi & -block) + w - r, body);
+                    for (; x < split; ++x)
+                        out[x] = P[x + r] + D[x - r - 1];
+                    for (const int e = std::min((hi & -block) + block - r, body); x < e; ++x)
+                        out[x] = P[x + r] - P[x - r - 1];
+                }
+                for (int x = body; x < cols; ++x)
+                {
+                    const int hi = cols - 1, lo1 = x - r - 1;
+                    out[x] = P[hi] + (lo1 / block == hi / block ? -P[lo1] : D[lo1]);
+                }
+            }
+
+            // Per-window model of a masked row: a = var / (var + eps) and b = mean -
+            // a * mean from the window sums and 1 / count, times the mask
+            void maskedModelRow(const float *sI, const float *sII, const float *inv, const float *m,
+                                float *a, float *b, float eps, int cols)
+            {
+                for (int x = 0; x < cols; ++x)
+                {
+                    const float mean = sI[x] * inv[x];
+                    const float var = std::max(sII[x] * inv[x] - mean * mean, 0.f);
+                    const float ak = var / (var + eps);
+                    a[x] = ak * m[x];
+                    b[x] = (mean - ak * mean) * m[x];
+                }
+            }
+
+            // Window sums of one stripe's rows, y ascending, over two or three
+            // planes. Each row is read once into the running vertical prefix, plus
+            // up to w - 1 rows above the first window (back to its block's start).
+            struct WindowRows
+            {
+                int cols = 0, rows = 0, r = 0, w = 0, planes = 0;
+                int block = 64;         // columns per horizontal block (>= w)
+                float *zero = nullptr;  // planes x cols
+                float *vert = nullptr;  // planes x cols: vertical window sums
+                float *t = nullptr;     // 2 x planes x cols: horizontal block prefixes P, D
+                float *sum = nullptr;   // planes x cols: window sums
+                float *mrow = nullptr;  // cols: a mask row as 0 / 1 floats (caller's)
+                float *ring = nullptr;  // w + 1 vertical prefix rows of planes x cols
+                int preEnd = INT_MIN / 2;
+
+                WindowRows(std::vector<float> &buf, int cols_, int rows_, int r_, int planes_)
+                    : cols(cols_), rows(rows_), r(r_), w(2 * r_ + 1), planes(planes_)
+                {
+                    while (block < w)
+                        block *= 2;
+                    const size_t row = (size_t)planes * cols;
+                    buf.assign(row * (std::min(w + 1, rows) + 5) + cols, 0.f);
+                    zero = buf.data();
+                    vert = zero + row;
+                    t = vert + row;
+                    sum = t + 2 * row;
+                    mrow = sum + row;
+                    ring = mrow + cols;
+                }
+                float *preRow(int j) { return ring + (size_t)(j % (w + 1)) * planes * cols; }
+                const float *sumRow(int c) const { return sum + (size_t)c * cols; }
+
+                // Window sums of row y into sum; rowFn(yy, src, dst) sets plane c of
+                // dst to plane c of src plus row yy's values (planes cols apart)
+                template <typename RowFn>
+                void advance(int y, RowFn &&rowFn)
+                {
+                    const int lo = std::max(0, y - r), hi = std::min(rows - 1, y + r), start = lo / w * w;
+                    preEnd = std::max(preEnd, start - 1);
+                    while (preEnd < hi)
+                    {
+                        ++preEnd;
+                        rowFn(preEnd, preEnd % w ? preRow(preEnd - 1) : zero, preRow(preEnd));
+                    }
+                    // P[hi] + P[end of lo's block] - P[lo - 1], the last two only
+                    // when they fall in lo's block
+                    const float *A = preRow(hi);
+                    const float *B = hi >= start + w ? preRow(start + w - 1) : zero;
+                    const float *C = lo > start ? preRow(lo - 1) : zero;
+                    const size_t n = (size_t)planes * cols;
+                    for (size_t i = 0; i < n; ++i)
+                        vert[i] = A[i] + B[i] - C[i];
+
+                    if (planes == 3)
+                        rowPrefixes<3>(vert, t, t + n, cols, block);
+                    else
+                        rowPrefixes<2>(vert, t, t + n, cols, block);
+                    for (int c = 0; c < planes; ++c)
+                        rowWindows(t + (size_t)c * cols, t + n + (size_t)c * cols, sum + (size_t)c * cols, cols, r, block);
+                }
+            };
+        } // namespace
+
+        void guidedFilterMasked(cv::Mat &score, const cv::Mat &mask, int radius, float eps,
+                                const Stripes &stripes, GuidedScratch &scratch, bool clampUnit)
+        {
+            const bool masked = !mask.empty();
+            CV_Assert(score.type() == CV_32F && (!masked || (mask.type() == CV_8UC1 && mask.size() == score.size())));
+            const int rows = score.rows, cols = score.cols, r = radius;
+            const int planes = masked ? 3 : 2;
+            const cv::Size sz = score.size();
+            cv::Mat A = scratchMat(scratch.a, sz, CV_32F), B = scratchMat(scratch.b, sz, CV_32F);
+            cv::Mat invN = masked ? scratchMat(scratch.invN, sz, CV_32F) : cv::Mat();
+            if ((int)scratch.rows.size() < stripes.count)
+                scratch.rows.resize(stripes.count);
+            const float lo = clampUnit ? 0.f : -FLT_MAX, hi = clampUnit ? 1.f : FLT_MAX;
+
+            // Rectangular ROI: the window pixel count is the clipped window size
+            std::vector<float> &invX = scratch.invSpanX;
+            invX.resize(cols);
+            for (int x = 0; x < cols; ++x)
+                invX[x] = 1.f / (float)(std::min(x + r, cols - 1) - std::max(x - r, 0) + 1);
+            auto invY = [&](int y) { return 1.f / (float)(std::min(y + r, rows - 1) - std::max(y - r, 0) + 1); };
+
+            // Mask row y as 0 / 1 floats, so the loops over it stay all-float
+            auto maskRow = [&](int y, float *Mf)
+            {
+                const uchar *Mp = mask.ptr<uchar>(y);
+                for (int x = 0; x < cols; ++x)
+                    Mf[x] = Mp[x] ? 1.f : 0.f;
+                return Mf;
+            };
+
+            // Pass 1: window mean/variance of I = score * M -> per-window model
+            // q = a * I + b, stored as a * M and b * M
+            parallelStripes(stripes, [&](int s, int y0, int y1)
+            {
+                WindowRows W(scratch.rows[s], cols, rows, r, planes);
+                for (int y = y0; y < y1; ++y)
+                {
+                    W.advance(y, [&](int yy, const float *src, float *dst)
+                    {
+                        const float *Sp = score.ptr<float>(yy);
+                        if (masked)
+                        {
+                            // one loop per plane: few enough streams to vectorize
+                            const float *Mf = maskRow(yy, W.mrow);
+                            for (int x = 0; x < cols; ++x)
+                                dst[x] = src[x] + Sp[x] * Mf[x];
+                            for (int x = 0; x < cols; ++x)
+                                dst[cols + x] = src[cols + x] + Sp[x] * Sp[x] * Mf[x];
+                            for (int x = 0; x < cols; ++x)
+                                dst[2 * cols + x] = src[2 * cols + x] + Mf[x];
+                        }
+                        else
+                        {
+                            for (int x = 0; x < cols; ++x)
+                            {
+                                dst[x] = src[x] + Sp[x];
+                                dst[cols + x] = src[cols + x] + Sp[x] * Sp[x];
+                            }
+                        }
+                    });
+                    const float *sI = W.sumRow(0), *sII = W.sumRow(1);
+                    float *a = A.ptr<float>(y), *b = B.ptr<float>(y);
+                    if (masked)
+                    {
+                        const float *sN = W.sumRow(2);
+                        const float *Mf = maskRow(y, W.mrow);
+                        float *in = invN.ptr<float>(y);
+                        // clamp apart from the division, or the loops keep a branch
+                        for (int x = 0; x < cols; ++x)
+                            in[x] = std::max(sN[x], 1.f);
+                        for (int x = 0; x < cols; ++x)
+                            in[x] = 1.f / in[x];
+                        maskedModelRow(sI, sII, in, Mf, a, b, eps, cols);
+                    }
+                    else
+                    {
+                        const float iy = invY(y);
+                        for (int x = 0; x < cols; ++x)
+                        {
+                            const float inv = invX[x] * iy;
+                            const float mean = sI[x] * inv;
+                            const float var = std::max(sII[x] * inv - mean * mean, 0.f);
+                            const float ak = var / (var + eps);
+                            a[x] = ak;
+                            b[x] = mean - ak * mean;
+                        }
+                    }
+                }
+            });
+
+            // Pass 2: q = mean(a) * I + mean(b) over the same windows, in place
+            parallelStripes(stripes, [&](int s, int y0, int y1)
+            {
+                WindowRows W(scratch.rows[s], cols, rows, r, 2);
+                for (int y = y0; y < y1; ++y)
+                {
+                    W.advance(y, [&](int yy, const float *src, float *dst)
+                    {
+                        const float *a = A.ptr<float>(yy), *b = B.ptr<float>(yy);
+                        for (int x = 0; x < cols; ++x)
+                        {
+                            dst[x] = src[x] + a[x];
+                            dst[cols + x] = src[cols + x] + b[x];
+                        }
+                    });
+                    const float *sA = W.sumRow(0), *sB = W.sumRow(1);
+                    float *Sp = score.ptr<float>(y);
+                    if (masked)
+                    {
+                        const uchar *Mp = mask.ptr<uchar>(y);
+                        const float *in = invN.ptr<float>(y);
+                        for (int x = 0; x < cols; ++x)
+                        {
+                            const float q = std::min(std::max((sA[x] * Sp[x] + sB[x]) * in[x], lo), hi);
+                            Sp[x] = Mp[x] ? q : Sp[x];
+                        }
+                    }
+                    else
+                    {
+                        const float iy = invY(y);
+                        for (int x = 0; x < cols; ++x)
+                            Sp[x] = std::min(std::max((sA[x] * Sp[x] + sB[x]) * (invX[x] * iy), lo), hi);
+                    }
+                }
+            });
+        }
+
+    } // namespace detail
+} // namespace thermal
@@ -0,0 +1,27 @@
+#pragma once
+// Internal edge-preserving smoothing of the score map (not installed).
+#include "parallel.hpp"
+#include "workspace.hpp"
+#include <opencv2/core.hpp>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Self-guided filter (He et al.) on a CV_32F score map restricted to mask.
+        // Box sums are normalized by the mask so pixels outside the ROI do not
+        // bleed in; an empty mask means the whole map (a rectangular ROI), which
+        // needs no mask or pixel-count planes. Two fused row passes: window sums
+        // of score and score^2 straight to the per-window model (a, b), then window
+        // sums of a and b straight to the output. Window sums come from prefix sums
+        // restarted on fixed blocks of rows and columns, so the cost per pixel does
+        // not depend on the radius and results do not depend on the stripes. The
+        // a, b (and masked 1/count) planes and the 2 * radius + 2 prefix rows of
+        // each stripe live in scratch (grow-only, reusable across calls).
+        // clampUnit clamps the result to [0, 1]; off for unclamped (absolute
+        // temperature) scores, which must keep their range.
+        void guidedFilterMasked(cv::Mat &score, const cv::Mat &mask, int radius, float eps,
+                                const Stripes &stripes, GuidedScratch &scratch, bool clampUnit = true);
+
+    } // namespace detail
+} // namespace thermal
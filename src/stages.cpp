@@ -0,0 +1,79 @@
+#include "stages.hpp"
+#include <algorithm>
+
+namespace thermal
+{
+    namespace detail
+    {
+        void stageIndexRow(const float *src, const float *T, int nT,
+                           uchar *idx, uint32_t *counts, int n)
+        {
+            if (nT <= 16)
+            {
+                // Few stages: branch-free compare-and-add over every threshold
+                for (int x = 0; x < n; ++x)
+                {
+                    const float s = src[x];
+                    int k = 0;
+                    for (int t = 0; t < nT; ++t)
+                        k += (s >= T[t]);
+                    idx[x] = (uchar)k;
+                }
+            }
+            else
+            {
+                for (int x = 0; x < n; ++x)
+                {
+                    const int k = (int)(std::upper_bound(T, T + nT, src[x]) - T);
+                    idx[x] = (uchar)k;
+                }
+            }
+            for (int x = 0; x < n; ++x)
+                counts[idx[x]]++;
+        }
+
+        void stageSelectedCounts(const std::vector<uint32_t> &counts, std::vector<int> &sel)
+        {
+            const int nT = (int)counts.size() - 1;
+            sel.assign(std::max(0, nT), 0);
+            int64_t above = 0;
+            for (int k = nT - 1; k >= 0; --k)
+            {
+                above += counts[k + 1];
+                sel[k] = (int)above;
+            }
+        }
+
+        void stageSelectedFromHistogram(const std::vector<uint32_t> &hist, const ScoreCdf &cdf,
+                                        const std::vector<float> &thresholds, std::vector<int> &sel)
+        {
+            const int bins = (int)hist.size();
+            uint64_t total = 0;
+            for (uint32_t c : hist)
+                total += c;
+
+            sel.clear();
+            // Thresholds ascend and pk is non-decreasing, so the boundary bin only
+            // moves up: one walk over the bins serves every threshold
+            uint64_t below = 0; // samples in bins [0, cur)
+            int cur = 0;
+            for (float T : thresholds)
+            {
+                const float xT = scoreAtRank(cdf, T);
+
+                const float fb = std::clamp(xT, 0.f, 1.f) * (float)bins;
+                const int b = std::min((int)fb, bins - 1);
+                if (b < cur)
+                {
+                    below = 0;
+                    cur = 0;
+                }
+                while (cur < b)
+                    below += hist[cur++];
+                const double above = (double)(total - below - hist[b]) + (double)hist[b] * std::max(0.0, (double)(b + 1) - fb);
+                sel.push_back((int)std::llround(above));
+            }
+        }
+
+    } // namespace detail
+} // namespace thermal
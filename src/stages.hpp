@@ -0,0 +1,42 @@
+#pragma once
+// Internal stage-map helpers (not installed).
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "cdf.hpp"
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Thresholds one 8-bit stage-index map can resolve
+        constexpr int MAX_STAGES = 255;
+
+        // One pass over an ROI span for all (ascending) thresholds:
+        // idx[x] = #{k : T[k] <= src[x]} and counts[idx[x]] is incremented
+        // (counts has nT + 1 bins). Pixels outside the ROI keep idx 0.
+        // Stage k then selects exactly the pixels with idx > k.
+        void stageIndexRow(const float *src, const float *T, int nT,
+                           uchar *idx, uint32_t *counts, int n);
+
+        // Pixels selected by each stage from the stage histogram: sel[k] = sum(counts[k+1..nT])
+        void stageSelectedCounts(const std::vector<uint32_t> &counts, std::vector<int> &sel);
+
+        // Stage counts without a stage map: each threshold quantile is mapped back to
+        // a score through the pk/tk knots and the score histogram is summed above it,
+        // splitting the boundary bin linearly. Error is at most one bin's population.
+        void stageSelectedFromHistogram(const std::vector<uint32_t> &hist, const ScoreCdf &cdf,
+                                        const std::vector<float> &thresholds, std::vector<int> &sel);
+
+        // Unselected share of the ROI in permille, rounded to 0.01
+        inline float mortarPermille(int selInRoi, int roiPixelsTotal)
+        {
+            const int unselInRoi = std::max(0, roiPixelsTotal - selInRoi);
+            const double ratio = (roiPixelsTotal > 0) ? static_cast<double>(unselInRoi) / static_cast<double>(roiPixelsTotal) : 0.0;
+            return static_cast<float>(std::round(ratio * 100000.0) / 100.0);
+        }
+
+    } // namespace detail
+} // namespace thermal
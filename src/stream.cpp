@@ -0,0 +1,208 @@
+#ifdef _WIN32
+#ifndef THERMAL_BUILD_DLL
+#define THERMAL_BUILD_DLL 1
+#endif
+#endif
+
+#include "thermal/core.hpp"
+#include "pipeline.hpp"
+#include "payload.hpp"
+#include <cmath>
+
+namespace thermal
+{
+    namespace detail
+    {
+        struct StreamState
+        {
+            Params params;
+            StreamParams sp;
+            Analysis analysis;
+            Workspace ws;
+            std::shared_ptr<StageRender> render;
+            std::vector<float> quantiles;       // stage schedule
+            std::vector<float> scoreT;          // the same thresholds in score units
+            std::vector<double> running;        // running histogram, sums to 1
+            std::vector<double> next;           // this frame's update, swapped in on success
+            ScoreGmm gmm;                       // group fit of running (warm start), swapped with analysis.gmm on success
+            bool warm = false;                  // running holds a history
+            bool geometry = false;              // spans valid for frame/roi below
+            cv::Size frame;
+            std::optional<Polygon> roi;
+            float drift = 0.f;
+            bool rebuilt = false;
+        };
+
+        static bool samePolygon(const std::optional<Polygon> &a, const std::optional<Polygon> &b)
+        {
+            if (a.has_value() != b.has_value())
+                return false;
+            return !a || (a->xs == b->xs && a->ys == b->ys);
+        }
+    } // namespace detail
+
+    THERMAL_API Stream::Stream(const Params &p, const StreamParams &sp)
+        : state_(new detail::StreamState())
+    {
+        state_->params = p;
+        state_->sp = sp;
+        detail::stageThresholds(p, state_->quantiles);
+    }
+
+    THERMAL_API Stream::~Stream() = default;
+    THERMAL_API Stream::Stream(Stream &&) noexcept = default;
+    THERMAL_API Stream &Stream::operator=(Stream &&) noexcept = default;
+
+    THERMAL_API void Stream::reset()
+    {
+        if (state_)
+            state_->warm = false;
+    }
+
+    THERMAL_API float Stream::drift() const
+    {
+        return state_ ? state_->drift : 0.f;
+    }
+
+    THERMAL_API bool Stream::rebuilt() const
+    {
+        return state_ ? state_->rebuilt : false;
+    }
+
+    THERMAL_API Result Stream::push(const cv::Mat &inRgba, const std::optional<Polygon> &roi)
+    {
+        Result R;
+        R.status = 0;
+        if (!state_)
+        {
+            R.status = -1;
+            R.message = "Stream was moved from";
+            return R;
+        }
+        detail::StreamState &S = *state_;
+        const Params &p = S.params;
+        try
+        {
+            if (inRgba.empty() || inRgba.type() != CV_8UC4)
+            {
+                R.status = -1;
+                R.message = "Input must be CV_8UC4 RGBA";
+                return R;
+            }
+            R.status = detail::validateScoreSource(p, R.message);
+            if (R.status != 0)
+                return R;
+            detail::Analysis &a = S.analysis;
+            detail::Workspace &ws = S.ws;
+            const detail::Control ctl(p);
+            const detail::ControlScope scope(ws, ctl);
+
+            // Geometry is only rebuilt when the frame size or the ROI changes
+            if (!S.geometry || S.frame != inRgba.size() || !detail::samePolygon(S.roi, roi))
+            {
+                a.frame = inRgba.size();
+                detail::rasterizeRoi(roi, inRgba.cols, inRgba.rows, a.spans, ws.maskBuf);
+                a.stripes = detail::Stripes(a.spans.rect.size(), p.numThreads);
+                S.frame = inRgba.size();
+                S.roi = roi;
+                S.geometry = true;
+                S.warm = false;
+            }
+
+            const detail::FrameView frame = detail::FrameView::fromRgba(inRgba);
+            detail::scoreMap(frame, p, a, ws);
+            const int bins = detail::cdfBinsFor(p.cdfBins, a.spans.pixels);
+            const uint64_t n = detail::scoreHistogram(a, bins, ws);
+            // A stopped frame leaves the running CDF untouched (here and after staging)
+            if (ctl.status() != 0)
+            {
+                detail::applyStop(ctl, R);
+                return R;
+            }
+            if (n < 100)
+            {
+                R.status = -6;
+                R.message = "Too few pixels in ROI";
+                return R;
+            }
+
+            // Drift: KS distance between this frame's CDF and the running one
+            const std::vector<uint32_t> &hist = ws.hist;
+            const double invN = 1.0 / (double)n;
+            const bool warm = S.warm && (int)S.running.size() == bins;
+            float drift = 0.f;
+            if (warm)
+            {
+                double cf = 0.0, cr = 0.0, ks = 0.0;
+                for (int b = 0; b < bins; ++b)
+                {
+                    cf += hist[b] * invN;
+                    cr += S.running[b];
+                    ks = std::max(ks, std::fabs(cf - cr));
+                }
+                drift = (float)ks;
+            }
+
+            // The update goes to S.next and is committed only if the frame completes
+            const double alpha = std::clamp((double)S.sp.decay, 1e-6, 1.0);
+            const bool rebuilt = !warm || drift > S.sp.maxDrift;
+            std::vector<double> &next = S.next;
+            next.resize(bins);
+            for (int b = 0; b < bins; ++b)
+            {
+                const double f = hist[b] * invN;
+                next[b] = rebuilt ? f : (1.0 - alpha) * S.running[b] + alpha * f;
+            }
+
+            detail::ScoreCdf &cdf = ws.cdf;
+            detail::buildCdfWeighted(next, 1.0, (double)n, cdf);
+            a.cdfError = cdf.maxError;
+            // Score groups of the running histogram; the stage map reads scores here.
+            // Refined from the committed fit unless the history was replaced; fitted
+            // in a.gmm and committed with the histogram, so a stopped frame keeps S.gmm.
+            if (p.scoreGroups)
+            {
+                if (!rebuilt)
+                    a.gmm = S.gmm;
+                detail::foldHistogram(next, a.gmm.hist);
+                detail::fitScoreGmm(a.gmm, (double)n, p.maxK, nullptr, !rebuilt);
+            }
+            else
+            {
+                a.gmm.k = 0;
+            }
+
+            // Quantile schedule -> score thresholds through the running CDF
+            S.scoreT.resize(S.quantiles.size());
+            for (size_t k = 0; k < S.quantiles.size(); ++k)
+                S.scoreT[k] = detail::scoreAtRank(cdf, S.quantiles[k]);
+
+            a.superpixels.count = 0;
+            if (p.superpixels)
+                detail::buildSuperpixels(a.tMap, a.spans, a.stripes, p.regionSize, p.compactness, a.superpixels, ws);
+
+            a.source = p.statsOnly ? nullptr : &frame;
+            detail::stageResult(a, S.scoreT, p, ws, S.render, R, &S.quantiles);
+            detail::applyStop(ctl, R);
+            a.source = nullptr;
+            // A frame stopped during staging leaves the running histogram as it was
+            if (R.status == 0)
+            {
+                S.running.swap(next);
+                std::swap(S.gmm, a.gmm);
+                S.warm = true;
+                S.drift = drift;
+                S.rebuilt = rebuilt;
+            }
+            return R;
+        }
+        catch (const cv::Exception &e)
+        {
+            S.analysis.source = nullptr;
+            R.status = -100;
+            R.message = e.what();
+            return R;
+        }
+    }
+
+} // namespace thermal
@@ -0,0 +1,363 @@
+#include "superpixel.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace thermal
+{
+    namespace detail
+    {
+        static constexpr int SLIC_ITERS = 5;
+        static constexpr float SLIC_VALUE_SPAN = 100.f;    // ROI score range -> Lab-L-like units
+        static constexpr float VALUE_FIXED = 65536.f;      // tMap sums in 16.16 fixed point
+
+        // Per-stripe sums of x, y, value (fixed point) and pixel count per superpixel,
+        // merged in stripe order into centres, means and sizes
+        static void updateCentres(const cv::Mat &tMap, const RoiSpans &spans, const Stripes &stripes,
+                                  Superpixels &sp, Workspace &ws)
+        {
+            std::vector<std::vector<int64_t>> &parts = ws.spParts;
+            parts.resize(stripes.count);
+            parallelStripes(stripes, [&](int s, int y0, int y1)
+            {
+                std::vector<int64_t> &acc = parts[s];
+                acc.assign((size_t)sp.count * 4, 0);
+                forEachSpan(spans, y0, y1, ws.control, [&](int y, int x0, int x1)
+                {
+                    const int *Lp = sp.labels.ptr<int>(y);
+                    const float *Tp = tMap.ptr<float>(y);
+                    for (int x = x0; x < x1; ++x)
+                    {
+                        int64_t *a = &acc[(size_t)Lp[x] * 4];
+                        a[0] += x;
+                        a[1] += y;
+                        a[2] += (int64_t)std::lround(Tp[x] * VALUE_FIXED);
+                        a[3] += 1;
+                    }
+                });
+            });
+            for (int i = 0; i < sp.count; ++i)
+            {
+                int64_t sx = 0, sy = 0, sv = 0, n = 0;
+                for (int s = 0; s < stripes.count; ++s)
+                {
+                    const int64_t *a = &parts[s][(size_t)i * 4];
+                    sx += a[0];
+                    sy += a[1];
+                    sv += a[2];
+                    n += a[3];
+                }
+                sp.size[i] = (int)n;
+                if (n == 0)
+                    continue;
+                sp.x[i] = (float)((double)sx / n);
+                sp.y[i] = (float)((double)sy / n);
+                sp.value[i] = (float)((double)sv / n / VALUE_FIXED);
+            }
+        }
+
+        // Components of one superpixel's pixels inside its window (3x3 cells around its
+        // seed cell, the only pixels SLIC may give it): comp holds the component per
+        // window pixel (-1 other labels), returns the component count. sizes gets
+        // the pixels per component, components are numbered in scanline order.
+        static int windowComponents(const Superpixels &sp, int label, const cv::Rect &win, std::vector<int> &comp,
+                                    std::vector<int> &stack, std::vector<int> &sizes)
+        {
+            comp.assign((size_t)win.area(), -1);
+            sizes.clear();
+            for (int wy = 0; wy < win.height; ++wy)
+            {
+                const int *Lp = sp.labels.ptr<int>(win.y + wy) + win.x;
+                for (int wx = 0; wx < win.width; ++wx)
+                {
+                    if (Lp[wx] != label || comp[wy * win.width + wx] >= 0)
+                        continue;
+                    const int c = (int)sizes.size();
+                    int n = 0;
+                    comp[wy * win.width + wx] = c;
+                    stack.assign(1, wy * win.width + wx);
+                    while (!stack.empty())
+                    {
+                        const int w = stack.back();
+                        stack.pop_back();
+                        ++n;
+                        const int qx = w % win.width, qy = w / win.width;
+                        const int nb[4] = {qx > 0 ? w - 1 : -1, qx + 1 < win.width ? w + 1 : -1,
+                                           qy > 0 ? w - win.width : -1, qy + 1 < win.height ? w + win.width : -1};
+                        for (int v : nb)
+                            if (v >= 0 && comp[v] < 0 &&
+                                sp.labels.ptr<int>(win.y + v / win.width)[win.x + v % win.width] == label)
+                            {
+                                comp[v] = c;
+                                stack.push_back(v);
+                            }
+                    }
+                    sizes.push_back(n);
+                }
+            }
+            return (int)sizes.size();
+        }
+
+        // SLIC connectivity step. Each superpixel keeps its largest 4-connected piece
+        // (the first in scanline order on a tie), found by a flood fill inside its
+        // window only, superpixels in parallel over grid rows. Every other piece
+        // takes the label of the first settled neighbour of its pixels, pieces in
+        // superpixel order, and hands its own on to cut-off pieces next to it. A part of
+        // the ROI made only of cut-off pieces (e.g. a detached lobe) becomes a new
+        // superpixel. Labels do not depend on the stripe partition.
+        static void enforceConnectivity(Superpixels &sp, const Stripes &stripes, Workspace &ws)
+        {
+            const int W = sp.labels.cols, H = sp.labels.rows, S = sp.cell;
+            Stripes gridRows;
+            gridRows.rows = sp.gridH;
+            gridRows.count = std::max(1, std::min(stripes.count, sp.gridH));
+            ws.spCutPixels.resize(gridRows.count);
+            ws.spCutPieces.resize(gridRows.count);
+            ws.spWindow.resize(gridRows.count);
+            ws.spStack.resize(gridRows.count);
+            ws.spSizes.resize(gridRows.count);
+            parallelStripes(gridRows, [&](int s, int gy0, int gy1)
+            {
+                std::vector<int> &pixels = ws.spCutPixels[s], &pieces = ws.spCutPieces[s];
+                std::vector<int> &comp = ws.spWindow[s], &sizes = ws.spSizes[s];
+                pixels.clear();
+                pieces.clear();         // per cut-off piece: label, end in pixels
+                for (int gy = gy0; gy < gy1 && !stopRequested(ws.control); ++gy)
+                    for (int gx = 0; gx < sp.gridW; ++gx)
+                    {
+                        const int label = gy * sp.gridW + gx;
+                        if (sp.size[label] == 0)
+                            continue;
+                        const int x0 = std::max(0, (gx - 1) * S), y0 = std::max(0, (gy - 1) * S);
+                        const cv::Rect win(x0, y0, std::min(W, (gx + 2) * S) - x0, std::min(H, (gy + 2) * S) - y0);
+                        const int n = windowComponents(sp, label, win, comp, ws.spStack[s], sizes);
+                        if (n <= 1)
+                            continue;
+                        const int keep = (int)(std::max_element(sizes.begin(), sizes.end()) - sizes.begin());
+                        // pixels of each other piece, grouped by piece in scanline order
+                        const size_t base = pixels.size();
+                        for (int c = 0, at = (int)base; c < n; ++c)
+                        {
+                            if (c == keep)
+                                continue;
+                            at += sizes[c];
+                            sizes[c] = at - sizes[c];       // now the piece's start
+                            pieces.push_back(label);
+                            pieces.push_back(at);
+                        }
+                        pixels.resize((size_t)pieces.back());
+                        for (int w = 0; w < win.area(); ++w)
+                        {
+                            const int c = comp[w];
+                            if (c >= 0 && c != keep)
+                                pixels[sizes[c]++] = (win.y + w / win.width) * W + win.x + w % win.width;
+                        }
+                    }
+            });
+            if (stopRequested(ws.control))
+                return;
+
+            // All cut-off pieces in superpixel order: label, start, settled label (-1 = not yet)
+            std::vector<int> &pixels = ws.spPixels, &pieces = ws.spPieces, &queue = ws.spQueue;
+            pixels.clear();
+            pieces.clear();
+            for (int s = 0; s < gridRows.count; ++s)
+            {
+                const int base = (int)pixels.size();
+                const std::vector<int> &part = ws.spCutPieces[s];
+                for (size_t k = 0, start = 0; k < part.size(); k += 2)
+                {
+                    pieces.push_back(part[k]);
+                    pieces.push_back(base + (int)start);
+                    pieces.push_back(-1);
+                    start = (size_t)part[k + 1];
+                }
+                pixels.insert(pixels.end(), ws.spCutPixels[s].begin(), ws.spCutPixels[s].end());
+            }
+            const int count = (int)pieces.size() / 3;
+            if (count == 0)
+                return;
+            auto end = [&](int id) { return id + 1 < count ? pieces[3 * (id + 1) + 1] : (int)pixels.size(); };
+            // Cut-off pixels read -2 - piece until their piece settles
+            int *L = sp.labels.ptr<int>(0);     // continuous (scratchMat)
+            for (int id = 0; id < count; ++id)
+                for (int k = pieces[3 * id + 1]; k < end(id); ++k)
+                    L[pixels[k]] = -2 - id;
+            auto neighbours = [&](int i, int nb[4])
+            {
+                const int x = i % W;
+                nb[0] = x > 0 ? i - 1 : -1;
+                nb[1] = i - W;
+                nb[2] = x + 1 < W ? i + 1 : -1;
+                nb[3] = i + W < W * H ? i + W : -1;
+            };
+            auto settle = [&](int id, int label)
+            {
+                pieces[3 * id + 2] = label;
+                for (int k = pieces[3 * id + 1]; k < end(id); ++k)
+                    L[pixels[k]] = label;
+                queue.push_back(id);
+            };
+            // Hand a settled piece's label on to the unsettled pieces it touches
+            auto spread = [&]
+            {
+                int nb[4];
+                for (size_t q = 0; q < queue.size(); ++q)
+                {
+                    const int id = queue[q];
+                    for (int k = pieces[3 * id + 1]; k < end(id); ++k)
+                    {
+                        neighbours(pixels[k], nb);
+                        for (int n : nb)
+                            if (n >= 0 && L[n] <= -2)
+                                settle(-2 - L[n], pieces[3 * id + 2]);
+                    }
+                }
+                queue.clear();
+            };
+
+            queue.clear();
+            int nb[4];
+            for (int id = 0; id < count; ++id)
+            {
+                if (pieces[3 * id + 2] >= 0)
+                    continue;
+                for (int k = pieces[3 * id + 1]; k < end(id) && pieces[3 * id + 2] < 0; ++k)
+                {
+                    neighbours(pixels[k], nb);
+                    for (int n : nb)
+                        if (n >= 0 && L[n] >= 0)
+                        {
+                            settle(id, L[n]);
+                            break;
+                        }
+                }
+            }
+            spread();
+            // Parts of the ROI with no settled piece at all: a new superpixel each
+            for (int id = 0; id < count; ++id)
+            {
+                if (pieces[3 * id + 2] >= 0)
+                    continue;
+                settle(id, sp.count++);
+                spread();
+            }
+            sp.x.resize(sp.count, 0.f);
+            sp.y.resize(sp.count, 0.f);
+            sp.value.resize(sp.count, 0.f);
+            sp.size.resize(sp.count, 0);
+        }
+
+        void buildSuperpixels(const cv::Mat &tMap, const RoiSpans &spans, const Stripes &stripes, int regionSize,
+                              int compactness, Superpixels &sp, Workspace &ws)
+        {
+            const cv::Size roi = spans.rect.size();
+            const int S = std::max(2, regionSize);
+            sp.cell = S;
+            sp.gridW = (roi.width + S - 1) / S;
+            sp.gridH = (roi.height + S - 1) / S;
+            sp.count = sp.gridW * sp.gridH;
+            sp.x.assign(sp.count, 0.f);
+            sp.y.assign(sp.count, 0.f);
+            sp.value.assign(sp.count, 0.f);
+            sp.size.assign(sp.count, 0);
+            sp.labels = scratchMat(sp.labelBuf, roi, CV_32S);
+            sp.labels.setTo(cv::Scalar(-1));
+
+            // Seeds: each grid cell's ROI pixels; per-stripe score range on the way
+            std::vector<cv::Vec2f> &ranges = ws.spRanges;
+            ranges.assign(stripes.count, cv::Vec2f(FLT_MAX, -FLT_MAX));
+            parallelStripes(stripes, [&](int s, int y0, int y1)
+            {
+                cv::Vec2f &r = ranges[s];
+                forEachSpan(spans, y0, y1, [&](int y, int x0, int x1)
+                {
+                    int *Lp = sp.labels.ptr<int>(y);
+                    const float *Tp = tMap.ptr<float>(y);
+                    const int row = (y / S) * sp.gridW;
+                    for (int x = x0; x < x1; ++x)
+                    {
+                        Lp[x] = row + x / S;
+                        r[0] = std::min(r[0], Tp[x]);
+                        r[1] = std::max(r[1], Tp[x]);
+                    }
+                });
+            });
+            updateCentres(tMap, spans, stripes, sp, ws);
+            float lo = FLT_MAX, hi = -FLT_MAX;
+            for (const cv::Vec2f &r : ranges)
+            {
+                lo = std::min(lo, r[0]);
+                hi = std::max(hi, r[1]);
+            }
+
+            // D^2 = (100 dv / range)^2 + (m / S)^2 ds^2 against the 3x3 neighbouring
+            // seeds: the ROI's score range spans 100 units whatever the score scale
+            // (ranks, clamped or absolute scores)
+            const float vs = hi > lo ? SLIC_VALUE_SPAN / (hi - lo) : 0.f;
+            const float wv = vs * vs;
+            const float wsd = (float)std::max(0, compactness) * (float)std::max(0, compactness) / ((float)S * S);
+            for (int it = 0; it < SLIC_ITERS && !stopRequested(ws.control); ++it)
+            {
+                parallelStripes(stripes, [&](int, int y0, int y1)
+                {
+                    forEachSpan(spans, y0, y1, ws.control, [&](int y, int x0, int x1)
+                    {
+                        int *Lp = sp.labels.ptr<int>(y);
+                        const float *Tp = tMap.ptr<float>(y);
+                        const int gy = y / S;
+                        const int gy0 = std::max(0, gy - 1), gy1 = std::min(sp.gridH - 1, gy + 1);
+                        for (int x = x0; x < x1; ++x)
+                        {
+                            const int gx = x / S;
+                            const int gx0 = std::max(0, gx - 1), gx1 = std::min(sp.gridW - 1, gx + 1);
+                            float best = FLT_MAX;
+                            int label = Lp[x];
+                            for (int cy = gy0; cy <= gy1; ++cy)
+                                for (int cx = gx0; cx <= gx1; ++cx)
+                                {
+                                    const int i = cy * sp.gridW + cx;
+                                    if (sp.size[i] == 0)
+                                        continue;
+                                    const float dv = Tp[x] - sp.value[i];
+                                    const float dx = (float)x - sp.x[i], dy = (float)y - sp.y[i];
+                                    const float d = wv * dv * dv + wsd * (dx * dx + dy * dy);
+                                    if (d < best)
+                                    {
+                                        best = d;
+                                        label = i;
+                                    }
+                                }
+                            Lp[x] = label;
+                        }
+                    });
+                });
+                updateCentres(tMap, spans, stripes, sp, ws);
+            }
+            if (!stopRequested(ws.control))
+            {
+                enforceConnectivity(sp, stripes, ws);
+                updateCentres(tMap, spans, stripes, sp, ws);
+            }
+        }
+
+        void Superpixels::edgeRows(cv::Mat &edges, int y0, int y1) const
+        {
+            const int W = labels.cols, H = labels.rows;
+            for (int y = y0; y < y1; ++y)
+            {
+                const int *L = labels.ptr<int>(y);
+                const int *Ln = y + 1 < H ? labels.ptr<int>(y + 1) : nullptr;
+                uchar *E = edges.ptr<uchar>(y);
+                for (int x = 0; x < W; ++x)
+                {
+                    const int l = L[x];
+                    const bool right = x + 1 < W && L[x + 1] >= 0 && L[x + 1] != l;
+                    const bool down = Ln && Ln[x] >= 0 && Ln[x] != l;
+                    E[x] = (l >= 0 && (right || down)) ? 255 : 0;
+                }
+            }
+        }
+
+    } // namespace detail
+} // namespace thermal
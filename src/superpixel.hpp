@@ -0,0 +1,46 @@
+#pragma once
+// Internal grid-seeded SLIC superpixels over the score map (not installed).
+#include "parallel.hpp"
+#include "roi.hpp"
+#include "workspace.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Superpixels of one analysis. Superpixel i starts as grid cell i
+        // (gridW x gridH cells of regionSize) and stays a candidate only for
+        // the pixels of the 3x3 cells around its own; the connectivity step then
+        // hands the pieces cut off from its largest one to neighbouring superpixels,
+        // or makes them superpixels of their own where they touch none.
+        struct Superpixels
+        {
+            int count = 0;              // gridW * gridH, plus the pieces made superpixels; 0 = not built
+            int gridW = 0, gridH = 0, cell = 0;
+            cv::Mat labels;             // CV_32S, spans.rect size; -1 outside the ROI
+            cv::Mat labelBuf;           // grow-only storage behind labels
+            std::vector<float> x, y;    // centre per superpixel, rect coords
+            std::vector<float> value;   // mean tMap value per superpixel
+            std::vector<int> size;      // ROI pixels per superpixel (0 = empty)
+
+            // Rows [y0, y1) of a CV_8UC1 map: 255 where the right or lower ROI neighbour
+            // belongs to another superpixel, else 0
+            void edgeRows(cv::Mat &edges, int y0, int y1) const;
+        };
+
+        // SLIC over tMap inside spans: value distance (the ROI's tMap range scaled to
+        // 100, like Lab L) against spatial distance weighted by compactness /
+        // regionSize. Every pass is a parallel row sweep with per-stripe integer sums
+        // merged in stripe order, so the result does not depend on the thread count.
+        // Connectivity then floods each superpixel inside its 3x3-cell window (in
+        // parallel over grid rows) and keeps its largest 4-connected piece; one
+        // serial pass over the other pieces merges each into an adjacent superpixel
+        // and the centres are recomputed.
+        // tMap is left as it is; stages read the superpixel means (value).
+        void buildSuperpixels(const cv::Mat &tMap, const RoiSpans &spans, const Stripes &stripes, int regionSize,
+                              int compactness, Superpixels &sp, Workspace &ws);
+
+    } // namespace detail
+} // namespace thermal
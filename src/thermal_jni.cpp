@@ -1,7 +1,6 @@
 #include <jni.h>
 #include <optional>
 #include <vector>
-#include <cstring>
 #include <string>
 #include <cstdio>
 
@@ -145,13 +144,17 @@ native_segmentRGBA(JNIEnv *env, jclass /*cls*/,
     p.doBilateral = (doBilateral == JNI_TRUE);
     p.stageSteps = stageSteps;
     p.maxK = maxK;
+    p.scoreGroups = true; // usedK/labelId를 Java로 넘기므로 그룹 적합 필요
     p.refineMode = (refineMode == JNI_TRUE);
     p.refineSteps = refineSteps;
     p.stageIdx = stageIdx;
 
-    // 코어 호출
+    // 코어 호출: 성공했을 때만 첫 스테이지를 outBuf에 직접 합성 (중간 버퍼/복사 없음,
+    // 실패/취소된 호출은 outBuf를 건드리지 않음)
     const bool wantIds = (needLabelIds == JNI_TRUE);
     auto R = thermal::segmentTempGroups(rgba, roi, p, /*needLabelIds=*/wantIds);
+    if (R.status == 0 && !R.stages.empty())
+        R.stages[0].renderTo(outPtr, (size_t)width * 4);
 
     // --------- Result -> Java outMeta ---------
     jclass metaCls = env->GetObjectClass(outMetaObj);
@@ -233,12 +236,6 @@ native_segmentRGBA(JNIEnv *env, jclass /*cls*/,
         env->SetObjectField(outMetaObj, fidLblIds, nullptr);
     }
 
-    // 첫 스테이지 RGBA → outBuf
-    const cv::Mat &out0 = R.stages.front().rgba;
-    if (out0.cols != width || out0.rows != height || out0.type() != CV_8UC4)
-        return -2;
-    std::memcpy(outPtr, out0.data, (size_t)(width * height * 4));
-
     return 0;
 }
 
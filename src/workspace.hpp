@@ -0,0 +1,67 @@
+#pragma once
+// Internal grow-only scratch memory reused across calls (not installed).
+#include "cdf.hpp"
+#include "gmm.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <opencv2/core.hpp>
+
+namespace thermal
+{
+    namespace detail
+    {
+        // Continuous header of size/type over buf. buf only ever grows, so repeated
+        // calls with the same (or smaller) sizes never allocate. The header does
+        // not own the memory: it is valid until buf grows or is released.
+        inline cv::Mat scratchMat(cv::Mat &buf, cv::Size size, int type)
+        {
+            const size_t bytes = std::max<size_t>((size_t)size.area() * CV_ELEM_SIZE(type), 1);
+            if (buf.empty() || buf.total() * buf.elemSize() < bytes)
+                buf.create(1, (int)bytes, CV_8U);
+            return cv::Mat(size, type, buf.data);
+        }
+
+        // Planes of guidedFilterMasked
+        struct GuidedScratch
+        {
+            cv::Mat a, b;                           // per-window model planes
+            cv::Mat invN;                           // 1 / window pixel count (masked ROI)
+            std::vector<std::vector<float>> rows;   // block prefix sums, per stripe
+            std::vector<float> invSpanX;            // 1 / window width (rectangular ROI)
+        };
+
+        // Everything a call needs besides its inputs and outputs
+        class Control;
+
+        struct Workspace
+        {
+            const Control *control = nullptr;               // stop polling of the current call
+            cv::Mat bgrBuf, smoothBuf, bgr32fBuf, labBuf;   // score path
+            cv::Mat maskBuf;                                // ROI / stage masks
+            GuidedScratch guided;
+            std::vector<std::vector<uint32_t>> histParts;   // per stripe
+            std::vector<std::vector<float>> exactParts;     // per stripe
+            std::vector<std::vector<float>> rowBufs;        // per stripe
+            std::vector<std::vector<uchar>> convBufs;       // per stripe: YUV rows converted for the score kernel
+            std::vector<uint32_t> hist;
+            std::vector<float> allS;
+            ScoreCdf cdf;
+            RankLut rankLut;
+            ScoreGmm gmm;                                   // stats-only path (else Analysis::gmm)
+            std::vector<std::vector<uint32_t>> stageParts;  // per stripe
+            std::vector<uint32_t> stageCounts;
+            std::vector<int> selCounts;
+            std::vector<std::vector<int64_t>> spParts;      // per stripe: superpixel sums
+            std::vector<cv::Vec2f> spRanges;                // per stripe: score min / max
+            std::vector<uchar> spStage;                     // stage index per superpixel
+            // superpixel connectivity: per grid-row stripe the window components, flood
+            // stack, component sizes and cut-off pieces; then all cut-off pieces
+            std::vector<std::vector<int>> spWindow, spStack, spSizes;
+            std::vector<std::vector<int>> spCutPixels, spCutPieces;
+            std::vector<int> spPixels, spPieces, spQueue;
+            std::vector<float> thresholds;
+        };
+
+    } // namespace detail
+} // namespace thermal
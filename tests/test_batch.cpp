@@ -0,0 +1,58 @@
+// segmentTempGroupsBatch against per-image segmentTempGroups: large images
+// tiled over the pool mixed with small ones grouped into shared tasks, and
+// OpenCV's parallel backend put back after each batch
+#include "test_util.hpp"
+
+using namespace thermal;
+
+int main()
+{
+    std::vector<BatchJob> jobs;
+    auto add = [&](int w, int h, unsigned seed, bool roi, bool ids)
+    {
+        BatchJob job;
+        job.image = thermal_test::thermalScene(w, h, seed);
+        if (roi)
+            job.roi = thermal_test::testRoi(w, h);
+        job.params.stageSteps = 4 + (int)(seed % 4);
+        job.params.scoreGroups = ids;
+        job.needLabelIds = ids;
+        jobs.push_back(job);
+    };
+    // at least 512x512 pixels: tiled; the rest grouped
+    add(800, 600, 1, true, true);
+    add(640, 480, 2, false, false);
+    for (unsigned i = 0; i < 10; ++i)
+        add(120 + 16 * (int)i, 96 + 8 * (int)i, 10 + i, i % 2 == 0, i % 3 == 0);
+    add(720, 540, 3, true, false);
+
+    std::vector<Result> refs;
+    for (const BatchJob &job : jobs)
+        refs.push_back(segmentTempGroups(job.image, job.roi, job.params, job.needLabelIds));
+
+    // OpenCV runs on the pool during a batch and is put back afterwards
+    const std::string cvFramework = cv::currentParallelFramework();
+    const int cvThreads = cv::getNumThreads();
+    for (int threads : {4, 1, 4})
+    {
+        const BatchReport report = segmentTempGroupsBatch(jobs, threads);
+        CHECK(report.threads == threads);
+        CHECK(report.results.size() == jobs.size());
+        for (size_t i = 0; i < jobs.size() && i < report.results.size(); ++i)
+        {
+            CHECK(report.results[i].status == 0);
+            CHECK(thermal_test::sameResult(report.results[i], refs[i]));
+        }
+        CHECK(cv::currentParallelFramework() == cvFramework);
+        CHECK(cv::getNumThreads() == cvThreads);
+    }
+
+    // Failures stay with their own job
+    jobs[3].image = cv::Mat();
+    const BatchReport report = segmentTempGroupsBatch(jobs, 4);
+    CHECK(report.results[3].status == -1);
+    CHECK(thermal_test::sameResult(report.results[0], refs[0]));
+    CHECK(thermal_test::sameResult(report.results[4], refs[4]));
+
+    return thermal_test::finish("test_batch");
+}
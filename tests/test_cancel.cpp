@@ -0,0 +1,101 @@
+// Cooperative cancellation (status -7) and deadlines (-8) on every entry point
+#include "test_util.hpp"
+#include <string>
+
+using namespace thermal;
+
+namespace
+{
+    bool cancelled(const Result &R)
+    {
+        return R.status == -7 && R.message == "Cancelled" && R.stages.empty();
+    }
+}
+
+int main()
+{
+    const cv::Mat scene = thermal_test::thermalScene(320, 240, 7);
+    const Polygon roi = thermal_test::testRoi(320, 240);
+    const auto token = std::make_shared<CancelToken>();
+    Params p;
+    p.cancel = token;
+    token->cancel();
+
+    // Cancelled before the call: every path returns promptly with -7
+    CHECK(cancelled(segmentTempGroups(scene, roi, p)));
+    Engine engine;
+    CHECK(cancelled(engine.run(scene, roi, p)));
+    const Plan plan(scene.size(), roi, p);
+    CHECK(plan.status() == 0);
+    CHECK(cancelled(engine.run(plan, scene)));
+    CHECK(Session(scene, roi, p).status() == -7);
+    Params stats = p;
+    stats.statsOnly = true;
+    CHECK(cancelled(segmentTempGroups(scene, roi, stats)));
+
+    // The engine is usable again once the token is reset; the token changes nothing else
+    token->reset();
+    CHECK(thermal_test::sameResult(engine.run(scene, roi, p), segmentTempGroups(scene, roi, Params())));
+    CHECK(thermal_test::sameResult(engine.run(plan, scene), segmentTempGroups(scene, roi, Params())));
+
+    // Cancelled from inside the call (here from the stage sink): partial stages are dropped
+    int delivered = 0;
+    const Result mid = segmentTempGroups(scene, roi, p, [&](int, const Payload &)
+    {
+        ++delivered;
+        token->cancel();
+        return true;
+    });
+    CHECK(cancelled(mid));
+    CHECK(delivered == 1);
+    token->reset();
+
+    // Stream: a stopped frame leaves the running histogram as it was
+    Stream stream(p);
+    CHECK(stream.push(scene, roi).status == 0);
+    CHECK(stream.push(scene, roi).status == 0);
+    CHECK(!stream.rebuilt());
+    const float drift = stream.drift();
+    cv::Mat inverted;
+    cv::subtract(1.0, thermal_test::temperatureField(320, 240, 8), inverted);
+    token->cancel();
+    CHECK(cancelled(stream.push(thermal_test::renderPalette(inverted, thermal_test::ironColors()), roi)));
+    CHECK(!stream.rebuilt() && stream.drift() == drift);
+    token->reset();
+    CHECK(stream.push(scene, roi).status == 0);
+    CHECK(!stream.rebuilt());
+
+    // Batch: only the cancelled job stops
+    std::vector<BatchJob> jobs(2);
+    jobs[0].image = scene;
+    jobs[0].roi = roi;
+    jobs[0].params = p;
+    jobs[1] = jobs[0];
+    jobs[1].params.cancel = nullptr;
+    token->cancel();
+    const BatchReport report = segmentTempGroupsBatch(jobs, 2);
+    CHECK(report.results.size() == 2);
+    if (report.results.size() == 2)
+    {
+        CHECK(cancelled(report.results[0]));
+        CHECK(report.results[1].status == 0);
+    }
+
+    // Deadline: the exact paths on 12 MP take far longer than 1 ms
+    const cv::Mat big = thermal_test::thermalScene(4000, 3000, 9);
+    Params slow;
+    slow.scoreSource = ScoreSource::LabExact;
+    slow.cdfMode = CdfMode::Exact;
+    slow.timeoutMs = 1;
+    const Result late = segmentTempGroups(big, std::nullopt, slow);
+    CHECK(late.status == -8);
+    CHECK(late.message == "Deadline exceeded");
+    CHECK(late.stages.empty());
+
+    // A deadline that is not reached changes nothing
+    slow.timeoutMs = 60000;
+    Params plain = slow;
+    plain.timeoutMs = 0;
+    CHECK(thermal_test::sameResult(segmentTempGroups(scene, roi, slow), segmentTempGroups(scene, roi, plain)));
+    return thermal_test::finish("test_cancel");
+}
@@ -0,0 +1,192 @@
+// Histogram CDF against the sort-based reference (buildCdfExact), the rank
+// table (RankLut) of both against the knot curve it samples, and the bin and
+// stripe budget of small ROIs
+#include "test_util.hpp"
+#include "cdf.hpp"
+
+using namespace thermal::detail;
+
+namespace
+{
+    std::vector<uint32_t> histogramOf(const std::vector<float> &vals, int bins)
+    {
+        std::vector<uint32_t> hist(bins, 0);
+        for (float v : vals)
+            ++hist[scoreBin(v, bins)];
+        return hist;
+    }
+
+    // Score samples in [0, 1]: uniform, two narrow peaks, heavy ties, and a
+    // single value repeated
+    std::vector<std::vector<float>> sampleSets()
+    {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> u(0.f, 1.f);
+        std::normal_distribution<float> n01(0.f, 1.f);
+        std::vector<std::vector<float>> sets(4);
+        for (int i = 0; i < 100000; ++i)
+        {
+            sets[0].push_back(u(rng));
+            const float peak = (i % 3) ? 0.3f : 0.71f;
+            sets[1].push_back(std::clamp(peak + 0.004f * n01(rng), 0.f, 1.f));
+            sets[2].push_back((float)(int)(u(rng) * 12.f) / 12.f);
+        }
+        sets[3].assign(1000, 0.5f);
+        sets.push_back({0.25f});
+        sets.push_back({0.9f, 0.1f});
+        return sets;
+    }
+
+    // Rank of x on the pk/tk knot curve (the per-pixel upper_bound reference)
+    float knotRank(const ScoreCdf &cdf, float x)
+    {
+        if (x <= cdf.pk.front())
+            return cdf.tk.front();
+        if (x >= cdf.pk.back())
+            return cdf.tk.back();
+        const int j = (int)(std::upper_bound(cdf.pk.begin(), cdf.pk.end(), x) - cdf.pk.begin());
+        const float t = (x - cdf.pk[j - 1]) / (cdf.pk[j] - cdf.pk[j - 1] + 1e-12f);
+        return cdf.tk[j - 1] * (1.f - t) + cdf.tk[j] * t;
+    }
+
+    // Every remapped rank between the knot curve's ranks one cell either side of x
+    int outsideKnotCurve(const ScoreCdf &cdf, const RankLut &lut)
+    {
+        const float step = 1.f / lut.invStep;
+        std::vector<float> xs;
+        for (int i = 0; i <= 20000; ++i)
+            xs.push_back(-0.1f + 1.2f * (float)i / 20000.f);
+        xs.insert(xs.end(), cdf.pk.begin(), cdf.pk.end());
+        xs.push_back(std::nanf(""));
+        std::vector<float> rs(xs.size());
+        lut.remapRow(xs.data(), rs.data(), (int)xs.size());
+        int outside = 0;
+        for (size_t i = 0; i + 1 < xs.size(); ++i)
+        {
+            const float lo = knotRank(cdf, xs[i] - step) - 1e-5f, hi = knotRank(cdf, xs[i] + step) + 1e-5f;
+            outside += rs[i] < lo || rs[i] > hi;
+        }
+        outside += rs.back() != cdf.tk.front(); // NaN reads cell 0
+        return outside;
+    }
+
+    // RankLut against the knot curve: the grid table stays between the curve's
+    // ranks one cell either side of x, the knot mode (resolution 0, Exact) equals it
+    void checkRankLut(const ScoreCdf &cdf)
+    {
+        // An Exact CDF has no bin width: sample its grid at 1/4096 of the range
+        const float resolution = cdf.maxError > 0.f ? cdf.maxError : (cdf.pk.back() - cdf.pk.front()) / 4096.f;
+        RankLut grid, knots;
+        grid.build(cdf, resolution);
+        knots.build(cdf, 0.f);
+        CHECK(knots.knots == &cdf);
+        if (!(cdf.pk.back() > cdf.pk.front()))
+        {
+            // One score value: the grid ranks everything tk.front(), the knot
+            // curve steps to tk.back() above it
+            const float x[3] = {cdf.pk.front() - 0.1f, cdf.pk.front(), cdf.pk.front() + 0.1f};
+            float r[3];
+            RankLut flat;
+            flat.build(cdf, 1.f / 256.f);
+            flat.remapRow(x, r, 3);
+            CHECK(r[0] == cdf.tk.front() && r[1] == cdf.tk.front() && r[2] == cdf.tk.front());
+            knots.remapRow(x, r, 3);
+            CHECK(r[0] == cdf.tk.front() && r[1] == cdf.tk.front() && r[2] == cdf.tk.back());
+            return;
+        }
+        CHECK(grid.knots == nullptr && grid.cells > 0 && grid.cells <= RANK_LUT_MAX_CELLS);
+        CHECK((double)grid.cells >= std::ceil((double)(cdf.pk.back() - cdf.pk.front()) / resolution) - 1.0);
+        CHECK(outsideKnotCurve(cdf, grid) == 0);
+
+        // Knot mode: bit-exact against the knot curve, NaN included
+        std::vector<float> xs;
+        for (int i = 0; i <= 20000; ++i)
+            xs.push_back(-0.1f + 1.2f * (float)i / 20000.f);
+        xs.insert(xs.end(), cdf.pk.begin(), cdf.pk.end());
+        std::vector<float> rk(xs.size());
+        knots.remapRow(xs.data(), rk.data(), (int)xs.size());
+        int knotMismatch = 0;
+        for (size_t i = 0; i < xs.size(); ++i)
+            knotMismatch += rk[i] != std::clamp(knotRank(cdf, xs[i]), 0.f, 1.f);
+        CHECK(knotMismatch == 0);
+        const float nan = std::nanf("");
+        float rn = 1.f;
+        knots.remapRow(&nan, &rn, 1);
+        CHECK(rn == cdf.tk.front());
+
+        // The knot walk fills every cell with the knot curve at the cell's score
+        const float cellStep = (cdf.pk.back() - grid.lo) / (float)grid.cells;
+        int cellMismatch = 0;
+        for (int i = 1; i < grid.cells; ++i)
+            cellMismatch += grid.r[i] != std::clamp(knotRank(cdf, grid.lo + cellStep * (float)i), 0.f, 1.f);
+        CHECK(cellMismatch == 0);
+        CHECK(grid.r[0] == cdf.tk.front() && grid.r[grid.cells] == cdf.tk.back());
+
+        // No more cells than the ROI has pixels: past that the knots are interpolated
+        RankLut capped, fits;
+        capped.build(cdf, resolution, grid.cells - 1);
+        fits.build(cdf, resolution, grid.cells);
+        CHECK(grid.cells == 1 || capped.knots == &cdf);
+        CHECK(fits.knots == nullptr && fits.cells == grid.cells);
+    }
+}
+
+int main()
+{
+    for (const std::vector<float> &vals : sampleSets())
+    {
+        std::vector<float> sorted = vals;
+        ScoreCdf exact;
+        buildCdfExact(sorted, exact);
+        CHECK(exact.maxError == 0.f);
+        checkRankLut(exact);
+        for (int bins : {256, 4096, 65536})
+        {
+            const std::vector<uint32_t> hist = histogramOf(vals, bins);
+            ScoreCdf cdf;
+            buildCdfHistogram(hist, vals.size(), cdf);
+            CHECK(cdf.maxError == 1.f / (float)bins);
+            CHECK((int)cdf.pk.size() == CDF_KNOTS && (int)cdf.tk.size() == CDF_KNOTS);
+
+            // Weighted path fed the same counts (a stream's first frame)
+            const std::vector<double> weights(hist.begin(), hist.end());
+            ScoreCdf weighted;
+            buildCdfWeighted(weights, (double)vals.size(), (double)vals.size(), weighted);
+
+            // Every knot within one bin of the sorted sample it stands for
+            double worst = 0.0, worstWeighted = 0.0;
+            bool ascending = true;
+            for (int i = 0; i < CDF_KNOTS; ++i)
+            {
+                worst = std::max(worst, (double)std::fabs(cdf.pk[i] - exact.pk[i]));
+                worstWeighted = std::max(worstWeighted, (double)std::fabs(weighted.pk[i] - exact.pk[i]));
+                CHECK(cdf.tk[i] == exact.tk[i]);
+                if (i > 0 && cdf.pk[i] < cdf.pk[i - 1])
+                    ascending = false;
+            }
+            CHECK(ascending);
+            CHECK_NEAR(worst, 0.0, cdf.maxError);
+            CHECK_NEAR(worstWeighted, 0.0, weighted.maxError);
+            if (bins == 65536)
+                checkRankLut(cdf);
+        }
+    }
+
+    // Out-of-range and NaN scores land in the end bins instead of indexing outside
+    CHECK(scoreBin(-0.5f, 256) == 0);
+    CHECK(scoreBin(1.f, 256) == 255);
+    CHECK(scoreBin(7.f, 256) == 255);
+    CHECK(scoreBin(std::nanf(""), 256) == 0);
+
+    // Bins in use: cdfBins within 256..2^20, capped by the ROI's pixel count
+    CHECK(cdfBinsFor(65536, 640 * 480) == 65536);
+    CHECK(cdfBinsFor(65536, 160 * 120) == 32768);
+    CHECK(cdfBinsFor(65536, 50) == 256);
+    CHECK(cdfBinsFor(100, 1 << 24) == 256);
+    CHECK(cdfBinsFor(1 << 22, 1 << 24) == (1 << 20));
+    // and each histogram stripe covers at least bins pixels
+    CHECK(histogramStripes(8, 65536, 320 * 240) == 1);
+    CHECK(histogramStripes(8, 65536, 4000 * 3000) == 8);
+    CHECK(histogramStripes(8, 32768, 160 * 120) == 1);
+    return thermal_test::finish("test_cdf");
+}
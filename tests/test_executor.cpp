@@ -0,0 +1,134 @@
+// Installed Executor: every parallel region of a call runs on it, a call keeps
+// the executor it started with when setExecutor replaces it mid-call, and
+// cv::parallel_for_ is routed to it while installed
+#include "test_util.hpp"
+#include <atomic>
+
+using namespace thermal;
+
+namespace
+{
+    // Runs regions inline and counts them; onRegion runs before region n (1-based)
+    class CountingExecutor : public Executor
+    {
+    public:
+        int concurrency() const override { return 4; }
+        void parallelFor(int count, const std::function<void(int)> &fn) override
+        {
+            const int n = ++regions;
+            if (onRegion)
+                onRegion(n);
+            for (int i = 0; i < count; ++i)
+                fn(i);
+        }
+        std::atomic<int> regions{0};
+        std::function<void(int)> onRegion;
+    };
+
+    class CountingBody : public cv::ParallelLoopBody
+    {
+    public:
+        explicit CountingBody(std::atomic<int> &n) : n_(n) {}
+        void operator()(const cv::Range &r) const override { n_ += r.end - r.start; }
+
+    private:
+        std::atomic<int> &n_;
+    };
+
+    // Counts the iterations whose cv::getThreadNum() is not below cv::getNumThreads()
+    class ThreadNumBody : public cv::ParallelLoopBody
+    {
+    public:
+        explicit ThreadNumBody(std::atomic<int> &bad) : bad_(bad) {}
+        void operator()(const cv::Range &r) const override
+        {
+            if (cv::getThreadNum() < 0 || cv::getThreadNum() >= cv::getNumThreads())
+                bad_ += r.end - r.start;
+        }
+
+    private:
+        std::atomic<int> &bad_;
+    };
+}
+
+int main()
+{
+    // Large enough for row-stripe regions
+    const cv::Mat scene = thermal_test::thermalScene(512, 512, 4);
+    const Polygon roi = thermal_test::testRoi(512, 512);
+    // No OpenCV filters inside the call (bilateral, opening): those follow the
+    // process-wide backend, so every region counted here is the library's own
+    Params p;
+    p.scoreGroups = true;
+    const Result ref = segmentTempGroups(scene, roi, p, true);
+    CHECK(ref.status == 0);
+
+    // Every region of a call on the executor, same result
+    auto a = std::make_shared<CountingExecutor>();
+    setExecutor(a);
+    CHECK(getExecutor() == a);
+    const Result onA = segmentTempGroups(scene, roi, p, true);
+    CHECK(thermal_test::sameResult(onA, ref));
+    const int perCall = a->regions;
+    CHECK(perCall >= 4);
+
+    // setExecutor during a call: the call finishes on the executor it started with
+    auto b = std::make_shared<CountingExecutor>();
+    a->regions = 0;
+    a->onRegion = [&](int n)
+    {
+        if (n == 1)
+            setExecutor(b);
+    };
+    const Result switched = segmentTempGroups(scene, roi, p, true);
+    CHECK(thermal_test::sameResult(switched, ref));
+    CHECK(a->regions == perCall);
+    CHECK(b->regions == 0);
+    a->onRegion = nullptr;
+
+    // the next call starts on the new one
+    const Result onB = segmentTempGroups(scene, roi, p, true);
+    CHECK(thermal_test::sameResult(onB, ref));
+    CHECK(b->regions == perCall);
+    CHECK(a->regions == perCall);
+
+    // Session and Stream calls too
+    b->regions = 0;
+    const Session session(scene, roi, p);
+    CHECK(session.status() == 0);
+    const int analysis = b->regions;
+    CHECK(analysis > 0);
+    CHECK(session.run(p).status == 0);
+    CHECK(b->regions > analysis);
+    b->regions = 0;
+    Stream stream(p);
+    CHECK(stream.push(scene, roi).status == 0);
+    CHECK(b->regions > 0);
+
+    // OpenCV's parallel_for_ goes through the executor while one is installed
+    std::atomic<int> ran(0);
+    b->regions = 0;
+    cv::parallel_for_(cv::Range(0, 16), CountingBody(ran), 16);
+    CHECK(ran == 16);
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && (CV_VERSION_MINOR > 5 || (CV_VERSION_MINOR == 5 && CV_VERSION_REVISION >= 2)))
+    CHECK(b->regions == 1);
+    // the calling thread joins too: its index stays below getNumThreads()
+    std::atomic<int> bad(0);
+    cv::parallel_for_(cv::Range(0, 16), ThreadNumBody(bad), 16);
+    CHECK(bad == 0);
+    CHECK(cv::getNumThreads() == b->concurrency() + 1);
+#endif
+
+    setExecutor(nullptr);
+    CHECK(!getExecutor());
+    const int routed = b->regions;
+    ran = 0;
+    cv::parallel_for_(cv::Range(0, 16), CountingBody(ran), 16);
+    CHECK(ran == 16);
+    CHECK(b->regions == routed);
+    const Result after = segmentTempGroups(scene, roi, p, true);
+    CHECK(thermal_test::sameResult(after, ref));
+    CHECK(a->regions == perCall && b->regions == routed);
+
+    return thermal_test::finish("test_executor");
+}
@@ -0,0 +1,134 @@
+// Every 8-bit ImageView PixelFormat against the RGBA path on the cvtColor'd frame.
+// The YUV row conversion matches cvtColor bit for bit, so results are exact.
+#include "test_util.hpp"
+#include <opencv2/imgproc.hpp>
+#include <cstring>
+
+using namespace thermal;
+
+namespace
+{
+    const int W = 320, H = 240;
+
+    // NV12 (uFirst) or NV21 frame as one CV_8UC1 Mat of H * 3 / 2 rows, from I420
+    cv::Mat interleave(const cv::Mat &i420, bool uFirst)
+    {
+        cv::Mat out = i420.clone();
+        const uchar *U = i420.ptr(H), *V = U + (W / 2) * (H / 2);
+        uchar *C = out.ptr(H);
+        for (int i = 0; i < (W / 2) * (H / 2); ++i)
+        {
+            C[2 * i] = uFirst ? U[i] : V[i];
+            C[2 * i + 1] = uFirst ? V[i] : U[i];
+        }
+        return out;
+    }
+
+    // view against segmentTempGroups on ref, with and without label ids, plus a plan
+    void checkView(const char *name, const ImageView &view, const cv::Mat &ref, const Polygon &roi)
+    {
+        for (bool needLabelIds : {false, true})
+        {
+            Params p;
+            p.scoreGroups = true;
+            const Result R = segmentTempGroups(view, roi, p, needLabelIds);
+            const bool same = thermal_test::sameResult(R, segmentTempGroups(ref, roi, p, needLabelIds));
+            if (!same)
+                std::fprintf(stderr, "  format %s (labelIds %d)\n", name, (int)needLabelIds);
+            CHECK(same);
+        }
+        const Plan plan(cv::Size(W, H), roi, Params());
+        Engine engine;
+        CHECK(thermal_test::sameResult(engine.run(plan, view), segmentTempGroups(ref, roi, Params())));
+    }
+}
+
+int main()
+{
+    const cv::Mat rgba = thermal_test::thermalScene(W, H, 12);
+    const Polygon roi = thermal_test::testRoi(W, H);
+    cv::Mat ref;
+
+    // Packed formats: same pixels as the RGBA frame
+    checkView("RGBA", ImageView(rgba, PixelFormat::RGBA), rgba, roi);
+    cv::Mat bgra, bgr;
+    cv::cvtColor(rgba, bgra, cv::COLOR_RGBA2BGRA);
+    cv::cvtColor(rgba, bgr, cv::COLOR_RGBA2BGR);
+    checkView("BGRA", ImageView(bgra, PixelFormat::BGRA), rgba, roi);
+    checkView("BGR", ImageView(bgr, PixelFormat::BGR), rgba, roi);
+
+    // Gray against its RGBA expansion
+    cv::Mat gray;
+    cv::cvtColor(rgba, gray, cv::COLOR_RGBA2GRAY);
+    cv::cvtColor(gray, ref, cv::COLOR_GRAY2RGBA);
+    checkView("Gray", ImageView(gray, PixelFormat::Gray), ref, roi);
+
+    // Strided rows (a view into wider buffers), also with the whole frame as ROI
+    cv::Mat wideBgr(H, W + 13, CV_8UC3), wideGray(H, W + 7, CV_8UC1);
+    cv::Mat bgrView = wideBgr(cv::Rect(0, 0, W, H)), grayView = wideGray(cv::Rect(3, 0, W, H));
+    bgr.copyTo(bgrView);
+    gray.copyTo(grayView);
+    checkView("BGR strided", ImageView(bgrView, PixelFormat::BGR), rgba, roi);
+    checkView("Gray strided", ImageView(grayView, PixelFormat::Gray), ref, roi);
+    CHECK(thermal_test::sameResult(segmentTempGroups(ImageView(bgrView, PixelFormat::BGR), std::nullopt, Params()),
+                                   segmentTempGroups(rgba, std::nullopt, Params())));
+
+    // YUV 4:2:0 against cvtColor's own conversion of the same bytes
+    cv::Mat i420;
+    cv::cvtColor(rgba, i420, cv::COLOR_RGBA2YUV_I420);
+    const cv::Mat nv12 = interleave(i420, true), nv21 = interleave(i420, false);
+    cv::cvtColor(i420, ref, cv::COLOR_YUV2RGBA_I420);
+    checkView("I420", ImageView(i420, PixelFormat::I420), ref, roi);
+    const cv::Mat i420Ref = ref.clone();
+    cv::cvtColor(nv12, ref, cv::COLOR_YUV2RGBA_NV12);
+    checkView("NV12", ImageView(nv12, PixelFormat::NV12), ref, roi);
+    cv::cvtColor(nv21, ref, cv::COLOR_YUV2RGBA_NV21);
+    checkView("NV21", ImageView(nv21, PixelFormat::NV21), ref, roi);
+
+    // Separate, padded planes (camera buffers): Y and chroma rows with their own strides
+    const int pad = 24;
+    std::vector<uchar> y((size_t)(W + pad) * H), vu((size_t)(W + pad) * (H / 2));
+    for (int r = 0; r < H; ++r)
+        std::memcpy(&y[(size_t)r * (W + pad)], nv21.ptr(r), W);
+    for (int r = 0; r < H / 2; ++r)
+        std::memcpy(&vu[(size_t)r * (W + pad)], nv21.ptr(H + r), W);
+    ImageView planes;
+    planes.format = PixelFormat::NV21;
+    planes.width = W;
+    planes.height = H;
+    planes.data = y.data();
+    planes.step = W + pad;
+    planes.chroma = vu.data();
+    planes.chromaStep = W + pad;
+    checkView("NV21 planes", planes, ref, roi);
+
+    const int cw = W / 2, cstep = cw + 8;
+    std::vector<uchar> u((size_t)cstep * (H / 2)), v((size_t)cstep * (H / 2));
+    const uchar *U = i420.ptr(H), *V = U + cw * (H / 2);
+    for (int r = 0; r < H / 2; ++r)
+    {
+        std::memcpy(&u[(size_t)r * cstep], U + r * cw, cw);
+        std::memcpy(&v[(size_t)r * cstep], V + r * cw, cw);
+    }
+    ImageView i420Planes;
+    i420Planes.format = PixelFormat::I420;
+    i420Planes.width = W;
+    i420Planes.height = H;
+    i420Planes.data = i420.data;
+    i420Planes.step = W;
+    i420Planes.chroma = u.data();
+    i420Planes.chromaV = v.data();
+    i420Planes.chromaStep = cstep;
+    checkView("I420 planes", i420Planes, i420Ref, roi);
+
+    // Odd YUV sizes and missing data are rejected
+    ImageView odd = planes;
+    odd.width = W - 1;
+    CHECK(segmentTempGroups(odd, roi, Params()).status == -1);
+    ImageView empty;
+    empty.format = PixelFormat::BGR;
+    empty.width = W;
+    empty.height = H;
+    CHECK(segmentTempGroups(empty, roi, Params()).status == -1);
+    return thermal_test::finish("test_formats");
+}
@@ -0,0 +1,184 @@
+// Score groups: the BIC search over K (capped by maxK, stopped after two worse K),
+// the warm refine, and usedK / labelIds / Stage::labelId on scenes of separated
+// temperature modes, per call and across Stream frames
+#include "test_util.hpp"
+#include "gmm.hpp"
+
+using namespace thermal;
+using namespace thermal::detail;
+
+namespace
+{
+    // GMM_BINS histogram of equal-weight normal modes
+    std::vector<double> modeHistogram(const std::vector<float> &means, float sd, int perMode, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> n01(0.f, 1.f);
+        std::vector<double> hist(GMM_BINS, 0.0);
+        for (float m : means)
+            for (int i = 0; i < perMode; ++i)
+                hist[scoreBin(std::clamp(m + sd * n01(rng), 0.f, 1.f), GMM_BINS)] += 1.0;
+        return hist;
+    }
+
+    // Vertical bands of widths share[] around levels[] with normal noise
+    cv::Mat bandField(int w, int h, const std::vector<float> &levels, const std::vector<float> &share, float sd,
+                      unsigned seed, std::vector<int> &band)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> n01(0.f, 1.f);
+        cv::Mat t(h, w, CV_32F);
+        band.assign((size_t)w * h, 0);
+        std::vector<int> edge;
+        float cum = 0.f;
+        for (float s : share)
+            edge.push_back((int)std::lround((cum += s) * w));
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+            {
+                const int b = (int)(std::upper_bound(edge.begin(), edge.end(), x) - edge.begin());
+                band[(size_t)y * w + x] = b;
+                t.at<float>(y, x) = levels[b] + sd * n01(rng);
+            }
+        return t;
+    }
+
+    // Group holding most of each stage's selected pixels, from the stage images
+    std::vector<int> dominantBands(const Result &R, const std::vector<int> &band, int bands)
+    {
+        std::vector<int> out;
+        for (const Payload &pl : R.stages)
+        {
+            const std::vector<uchar> sel = thermal_test::selection(pl);
+            std::vector<int> count(bands, 0);
+            for (size_t i = 0; i < sel.size(); ++i)
+                count[band[i]] += sel[i];
+            out.push_back((int)(std::max_element(count.begin(), count.end()) - count.begin()));
+        }
+        return out;
+    }
+}
+
+int main()
+{
+    // K search on histograms of 1..3 separated modes
+    const std::vector<float> modes = {0.2f, 0.5f, 0.8f};
+    for (int M = 1; M <= 3; ++M)
+    {
+        ScoreGmm g;
+        g.hist = modeHistogram(std::vector<float>(modes.begin(), modes.begin() + M), 0.03f, 20000, 3 + M);
+        const double n = 20000.0 * M;
+        fitScoreGmm(g, n, 7, nullptr);
+        CHECK(g.k == M);
+        // best K, then two larger K fitting worse: the search stops there
+        CHECK(g.searched == M + 2);
+        for (int j = 0; j < g.k && j < M; ++j)
+        {
+            CHECK_NEAR(g.mean[j], modes[j], 0.005);
+            CHECK_NEAR(g.weight[j], 1.0 / M, 0.01);
+        }
+        for (int j = 0; j + 1 < g.k; ++j)
+            CHECK(g.mean[j] < g.mean[j + 1]);
+        for (int j = 0; j < M; ++j)
+            CHECK(g.labelOf(modes[j]) == j);
+
+        // maxK caps the search
+        for (int maxK = 1; maxK < M; ++maxK)
+        {
+            ScoreGmm capped;
+            capped.hist = g.hist;
+            fitScoreGmm(capped, n, maxK, nullptr);
+            CHECK(capped.k == maxK);
+            CHECK(capped.searched == maxK);
+        }
+    }
+
+    // Warm refine: same K from the previous fit, following shifted modes
+    {
+        ScoreGmm g;
+        g.hist = modeHistogram(modes, 0.03f, 20000, 7);
+        fitScoreGmm(g, 60000.0, 5, nullptr);
+        CHECK(g.k == 3);
+        g.hist = modeHistogram({0.23f, 0.52f, 0.79f}, 0.03f, 20000, 8);
+        fitScoreGmm(g, 60000.0, 5, nullptr, true);
+        CHECK(g.k == 3);
+        CHECK(g.searched == 0);
+        CHECK_NEAR(g.mean[0], 0.23, 0.005);
+        CHECK_NEAR(g.mean[1], 0.52, 0.005);
+        CHECK_NEAR(g.mean[2], 0.79, 0.005);
+        // a lower maxK refines the coldest maxK components
+        fitScoreGmm(g, 60000.0, 2, nullptr, true);
+        CHECK(g.k == 2);
+        CHECK(g.searched == 0);
+        // nothing to start from: searched
+        g.k = 0;
+        fitScoreGmm(g, 60000.0, 5, nullptr, true);
+        CHECK(g.k == 3);
+        CHECK(g.searched == 5);
+    }
+
+    // Per call: usedK is the number of modes, each pixel labelled with its mode.
+    // Radiometric bands: scores linear in temperature, so the modes stay normal.
+    const int W = 240, H = 160;
+    const std::vector<float> share = {0.25f, 0.35f, 0.4f};
+    for (int M = 2; M <= 3; ++M)
+    {
+        const std::vector<float> levels = M == 3 ? std::vector<float>{10.f, 60.f, 120.f} : std::vector<float>{20.f, 100.f};
+        const std::vector<float> widths = M == 3 ? share : std::vector<float>{0.45f, 0.55f};
+        std::vector<int> band;
+        const cv::Mat raw = bandField(W, H, levels, widths, 2.f, 30 + M, band);
+        Params p;
+        p.scoreGroups = true;
+        const Result R = segmentRadiometric(raw, std::nullopt, p, true);
+        CHECK(R.status == 0);
+        CHECK(R.usedK == M);
+        CHECK(R.labelIds.size() == band.size());
+        int wrong = 0;
+        for (size_t i = 0; i < R.labelIds.size() && i < band.size(); ++i)
+            wrong += R.labelIds[i] != band[i];
+        CHECK(wrong == 0);
+        const std::vector<int> dom = dominantBands(R, band, M);
+        CHECK(dom.size() == R.stages.size());
+        for (size_t k = 0; k < R.stages.size() && k < dom.size(); ++k)
+            CHECK(R.stages[k].labelId == dom[k]);
+
+        // fewer groups allowed than modes: usedK stays within maxK
+        for (int maxK = 1; maxK <= 7; ++maxK)
+        {
+            Params q = p;
+            q.maxK = maxK;
+            const Result C = segmentRadiometric(raw, std::nullopt, q, true);
+            CHECK(C.status == 0);
+            CHECK(C.usedK == std::min(maxK, M));
+            for (int id : C.labelIds)
+                CHECK(id >= 0 && id < C.usedK);
+        }
+    }
+
+    // Stream: groups refined from the previous frame while the modes drift.
+    // Iron-rendered bands, kept narrow so the palette's nonlinear score stays one mode each.
+    {
+        Params p;
+        p.scoreGroups = true;
+        StreamParams sp;
+        sp.maxDrift = 0.5f;     // narrow modes: any shift moves the CDF a lot; keep the history
+        Stream stream(p, sp);
+        for (int f = 0; f < 6; ++f)
+        {
+            const float d = 0.01f * f;
+            std::vector<int> band;
+            const cv::Mat t = bandField(W, H, {0.2f + d, 0.5f + d, 0.8f + d}, share, 0.003f, 40 + f, band);
+            const cv::Mat scene = thermal_test::renderPalette(t, thermal_test::ironColors());
+            const Result R = stream.push(scene);
+            CHECK(R.status == 0);
+            CHECK(f == 0 || !stream.rebuilt());
+            CHECK(R.usedK == 3);
+            const std::vector<int> dom = dominantBands(R, band, 3);
+            for (size_t k = 0; k < R.stages.size() && k < dom.size(); ++k)
+                CHECK(R.stages[k].labelId == dom[k]);
+            CHECK(!R.stages.empty() && R.stages.back().labelId == 2);
+        }
+    }
+
+    return thermal_test::finish("test_gmm");
+}
@@ -0,0 +1,120 @@
+// Caller-owned stage buffers: Payload::renderTo(data, step) and StageOutput
+// composite the same image as rgba() into rows of any stride, leaving the row
+// padding alone; only a successful call writes them, bad requests get -2
+#include "test_util.hpp"
+
+using namespace thermal;
+
+namespace
+{
+    const uchar FILL = 7;
+    const int PAD = 13;     // bytes of padding after each row
+
+    // Input-sized RGBA rows PAD bytes apart, prefilled with FILL
+    struct Buffer
+    {
+        Buffer(cv::Size s) : size(s), step((size_t)s.width * 4 + PAD), bytes(step * s.height, FILL) {}
+
+        StageOutput at(int stage) { return StageOutput{stage, bytes.data(), step}; }
+        cv::Mat view() { return cv::Mat(size, CV_8UC4, bytes.data(), step); }
+
+        // Image rows equal img, padding untouched
+        bool holds(const cv::Mat &img)
+        {
+            return cv::norm(view(), img, cv::NORM_INF) == 0.0 && paddingIntact();
+        }
+        bool paddingIntact() const
+        {
+            for (int y = 0; y < size.height; ++y)
+                for (size_t i = (size_t)size.width * 4; i < step; ++i)
+                    if (bytes[y * step + i] != FILL)
+                        return false;
+            return true;
+        }
+        bool untouched() const
+        {
+            return std::all_of(bytes.begin(), bytes.end(), [](uchar b) { return b == FILL; });
+        }
+
+        cv::Size size;
+        size_t step;
+        std::vector<uchar> bytes;
+    };
+}
+
+int main()
+{
+    const int W = 320, H = 240;
+    const cv::Mat scene = thermal_test::thermalScene(W, H, 11);
+    const Polygon roi = thermal_test::testRoi(W, H);
+    Params p;
+    p.stageSteps = 5;
+    const Result ref = segmentTempGroups(scene, roi, p);
+    CHECK(ref.status == 0);
+    CHECK(ref.stages.size() == 5);
+    if (ref.stages.size() != 5)
+        return thermal_test::finish("test_outputs");
+
+    // renderTo(data, step): padded and packed rows, the image of rgba()
+    for (const Payload &pl : ref.stages)
+    {
+        CHECK(pl.size() == scene.size());
+        Buffer padded(scene.size());
+        CHECK(pl.renderTo(padded.bytes.data(), padded.step));
+        CHECK(padded.holds(pl.rgba()));
+        std::vector<uchar> packed((size_t)W * H * 4, FILL);
+        CHECK(pl.renderTo(packed.data(), 0));
+        CHECK(cv::norm(cv::Mat(scene.size(), CV_8UC4, packed.data()), pl.rgba(), cv::NORM_INF) == 0.0);
+    }
+    // nothing written without an image or a buffer
+    {
+        Buffer b(scene.size());
+        const Payload none;
+        CHECK(none.size().empty());
+        CHECK(!none.renderTo(b.bytes.data(), b.step));
+        CHECK(b.untouched());
+        CHECK(!ref.stages[0].renderTo(nullptr, b.step));
+    }
+
+    // StageOutput: the requested stages composited during the call
+    Engine engine;
+    using Call = std::function<Result(const cv::Mat &, const Params &, const std::vector<StageOutput> &)>;
+    const std::vector<Call> calls = {
+        [&](const cv::Mat &in, const Params &q, const std::vector<StageOutput> &o) { return segmentTempGroups(in, roi, q, o); },
+        [&](const cv::Mat &in, const Params &q, const std::vector<StageOutput> &o) { return engine.run(in, roi, q, o); }};
+    for (const Call &call : calls)
+    {
+        Buffer s0(scene.size()), s3(scene.size()), again3(scene.size());
+        const std::vector<StageOutput> outputs = {s0.at(0), s3.at(3), again3.at(3), StageOutput{2, nullptr, 0}};
+        const Result R = call(scene, p, outputs);
+        CHECK(thermal_test::sameResult(R, ref));
+        CHECK(s0.holds(ref.stages[0].rgba()));
+        CHECK(s3.holds(ref.stages[3].rgba()));
+        CHECK(again3.holds(ref.stages[3].rgba()));
+        // the payloads keep their images
+        CHECK(!R.stages.empty() && R.stages[0].hasImage());
+
+        // stages the call does not produce, and statsOnly (no images): -2, nothing written
+        Buffer first(scene.size()), none(scene.size());
+        for (int stage : {5, -1})
+        {
+            const Result bad = call(scene, p, {first.at(0), none.at(stage)});
+            CHECK(bad.status == -2 && bad.stages.empty());
+        }
+        Params stats = p;
+        stats.statsOnly = true;
+        CHECK(call(scene, stats, {none.at(0)}).status == -2);
+        CHECK(call(scene, stats, {StageOutput{0, nullptr, 0}}).status == 0);
+        // failed and cancelled calls leave the buffers alone
+        CHECK(call(cv::Mat(), p, {none.at(0)}).status == -1);
+        Params cancelled = p;
+        const auto token = std::make_shared<CancelToken>();
+        token->cancel();
+        cancelled.cancel = token;
+        CHECK(call(scene, cancelled, {first.at(0), none.at(3)}).status == -7);
+        CHECK(first.untouched());
+        CHECK(none.untouched());
+    }
+
+    return thermal_test::finish("test_outputs");
+}
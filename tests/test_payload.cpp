@@ -0,0 +1,139 @@
+// Lazy Payload images: every stage of a result shares one stage map, nothing is
+// composited until rgba() (then cached once, also across copies and threads),
+// renderTo composites without caching (into a padded view in place), and
+// payloads outlive their result
+#include "test_util.hpp"
+#include "payload.hpp"
+#include <thread>
+
+using namespace thermal;
+using namespace thermal::detail;
+
+namespace
+{
+    // Stage k image from the shared stage map: the input inside the ROI where the
+    // map is above k, opaque black elsewhere
+    bool matchesStageMap(const cv::Mat &img, const cv::Mat &in, const StageRender &r, int k)
+    {
+        const cv::Vec4b black(0, 0, 0, 255);
+        for (int y = 0; y < in.rows; ++y)
+            for (int x = 0; x < in.cols; ++x)
+            {
+                const bool inRect = r.roiRect.contains(cv::Point(x, y));
+                const bool sel = inRect && r.stageMap.at<uchar>(y - r.roiRect.y, x - r.roiRect.x) > k;
+                if (img.at<cv::Vec4b>(y, x) != (sel ? in.at<cv::Vec4b>(y, x) : black))
+                    return false;
+            }
+        return true;
+    }
+
+    bool sameImage(const cv::Mat &a, const cv::Mat &b)
+    {
+        return a.size() == b.size() && a.type() == b.type() && cv::norm(a, b, cv::NORM_INF) == 0.0;
+    }
+}
+
+int main()
+{
+    const int W = 320, H = 240;
+    const cv::Mat scene = thermal_test::thermalScene(W, H, 9);
+    const Polygon roi = thermal_test::testRoi(W, H);
+    Params p;
+    p.stageSteps = 6;
+
+    cv::Mat kept;
+    Payload survivor;
+    {
+        const Result R = segmentTempGroups(scene, roi, p);
+        CHECK(R.status == 0);
+        CHECK(!R.stages.empty());
+        const StageRender *shared = PayloadAccess::render(R.stages[0]);
+        CHECK(shared != nullptr);
+        for (const Payload &pl : R.stages)
+        {
+            // one stage map behind every stage, nothing composited yet
+            CHECK(pl.hasImage());
+            CHECK(PayloadAccess::render(pl) == shared);
+            CHECK(!PayloadAccess::cached(pl));
+        }
+        if (!shared)
+            return thermal_test::finish("test_payload");
+        CHECK(shared->stageMap.size() == shared->roiRect.size());
+
+        // rgba(): composited on first access, cached for this stage only
+        const Payload &pl2 = R.stages[2];
+        const cv::Mat &img2 = pl2.rgba();
+        CHECK(img2.size() == scene.size() && img2.type() == CV_8UC4);
+        CHECK(matchesStageMap(img2, scene, *shared, 2));
+        CHECK(PayloadAccess::cached(pl2));
+        CHECK(&pl2.rgba() == &img2 && pl2.rgba().data == img2.data);
+        for (size_t k = 0; k < R.stages.size(); ++k)
+            CHECK(PayloadAccess::cached(R.stages[k]) == (k == 2));
+        // copies share the cache
+        const Payload copy = pl2;
+        CHECK(copy.rgba().data == img2.data);
+
+        // renderTo composites without caching: allocated, reallocated when the
+        // wrong size, and in place into an input-sized padded view
+        const Payload &pl3 = R.stages[3];
+        cv::Mat fresh;
+        pl3.renderTo(fresh);
+        CHECK(matchesStageMap(fresh, scene, *shared, 3));
+        CHECK(!PayloadAccess::cached(pl3));
+        cv::Mat small(10, 10, CV_8UC4, cv::Scalar::all(1));
+        pl3.renderTo(small);
+        CHECK(sameImage(small, fresh));
+        cv::Mat padded(H, W + 13, CV_8UC4, cv::Scalar::all(7));
+        cv::Mat view = padded(cv::Rect(5, 0, W, H));
+        const uchar *viewData = view.data;
+        pl3.renderTo(view);
+        CHECK(view.data == viewData);
+        CHECK(sameImage(view, fresh));
+        int padTouched = 0;
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W + 13; ++x)
+                if (x < 5 || x >= 5 + W)
+                    padTouched += padded.at<cv::Vec4b>(y, x) != cv::Vec4b(7, 7, 7, 7);
+        CHECK(padTouched == 0);
+        CHECK(sameImage(pl3.rgba(), fresh));
+
+        // Each stage selects a subset of the one before
+        for (size_t k = 1; k < R.stages.size(); ++k)
+        {
+            const std::vector<uchar> a = thermal_test::selection(R.stages[k - 1]), b = thermal_test::selection(R.stages[k]);
+            int extra = 0;
+            for (size_t i = 0; i < a.size(); ++i)
+                extra += b[i] && !a[i];
+            CHECK(extra == 0);
+        }
+
+        // Several threads asking for one stage composite it once
+        const Payload &pl4 = R.stages[4];
+        std::vector<const uchar *> seen(4, nullptr);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+            threads.emplace_back([&, t] { seen[t] = pl4.rgba().data; });
+        for (std::thread &t : threads)
+            t.join();
+        for (const uchar *d : seen)
+            CHECK(d != nullptr && d == seen[0]);
+        CHECK(matchesStageMap(pl4.rgba(), scene, *shared, 4));
+
+        survivor = R.stages[1];
+        R.stages[1].renderTo(kept);
+    }
+
+    // A payload keeps the shared stage map alive after its Result is gone
+    CHECK(survivor.hasImage());
+    CHECK(sameImage(survivor.rgba(), kept));
+
+    // Payloads without an image
+    const Payload none;
+    CHECK(!none.hasImage());
+    CHECK(none.rgba().empty());
+    cv::Mat dst(4, 4, CV_8UC4);
+    none.renderTo(dst);
+    CHECK(dst.empty());
+
+    return thermal_test::finish("test_payload");
+}
@@ -0,0 +1,50 @@
+// Engine::run(plan, frame) against segmentTempGroups with the plan's ROI and Params
+#include "test_util.hpp"
+
+using namespace thermal;
+
+int main()
+{
+    const cv::Size size(320, 240);
+    const Polygon roi = thermal_test::testRoi(size.width, size.height);
+    std::vector<cv::Mat> frames;
+    for (unsigned seed = 10; seed < 14; ++seed)
+        frames.push_back(thermal_test::thermalScene(size.width, size.height, seed));
+
+    // One plan and one engine per variant over several frames: scratch reuse
+    // must not leak state from one frame into the next
+    std::vector<Params> variants(5);
+    variants[1].cdfMode = CdfMode::Exact;
+    variants[2].doBilateral = true;
+    variants[2].smoothMode = SmoothMode::Guided;
+    variants[3].statsOnly = true;
+    variants[4].refineMode = true;
+    variants[4].stageIdx = 2;
+    for (const Params &p : variants)
+    {
+        for (bool needLabelIds : {false, true})
+        {
+            const Plan plan(size, roi, p, needLabelIds);
+            CHECK(plan.status() == 0);
+            CHECK(plan.frameSize() == size);
+            Engine engine;
+            for (const cv::Mat &frame : frames)
+                CHECK(thermal_test::sameResult(engine.run(plan, frame), segmentTempGroups(frame, roi, p, needLabelIds)));
+        }
+    }
+
+    // No ROI: the whole frame
+    const Plan whole(size, std::nullopt, Params());
+    Engine engine;
+    CHECK(thermal_test::sameResult(engine.run(whole, frames[0]), segmentTempGroups(frames[0], std::nullopt, Params())));
+
+    // Errors: at construction, and frames of another size
+    CHECK(Plan(cv::Size(), roi, Params()).status() == -1);
+    Params bad;
+    bad.stageSteps = 0;
+    const Plan invalid(size, roi, bad);
+    CHECK(invalid.status() == -2);
+    CHECK(engine.run(invalid, frames[0]).status == -2);
+    CHECK(engine.run(whole, thermal_test::thermalScene(160, 120)).status == -1);
+    return thermal_test::finish("test_plan");
+}
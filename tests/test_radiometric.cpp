@@ -0,0 +1,160 @@
+// Radiometric frames: step / alignment checks of the ImageView, Raw16 / RawF32
+// scores against rawGain / rawOffset / tempMin / tempMax, and the documented
+// scores of non-finite RawF32 pixels (NaN, -inf -> tempMin, +inf -> tempMax)
+#include "test_util.hpp"
+#include "frame.hpp"
+#include <limits>
+
+using namespace thermal;
+
+namespace
+{
+    int viewStatus(PixelFormat f, const void *data, int w, int h, size_t step)
+    {
+        ImageView img;
+        img.format = f;
+        img.width = w;
+        img.height = h;
+        img.data = data;
+        img.step = step;
+        detail::FrameView view;
+        std::string msg;
+        return detail::FrameView::fromImage(img, view, msg);
+    }
+
+    float expectedScore(double temp, const Params &p, bool clamp)
+    {
+        if (std::isnan(temp) || temp == -INFINITY)
+            return 0.f;
+        if (temp == INFINITY)
+            return 1.f;
+        const double s = (temp - p.tempMin) / (p.tempMax - p.tempMin);
+        return (float)(clamp ? std::clamp(s, 0.0, 1.0) : s);
+    }
+
+    detail::FrameView rawView(const cv::Mat &raw, const Params &p)
+    {
+        detail::FrameView view;
+        std::string msg;
+        const PixelFormat f = raw.type() == CV_16UC1 ? PixelFormat::Raw16 : PixelFormat::RawF32;
+        CHECK(detail::FrameView::fromImage(ImageView(raw, f), view, msg) == 0);
+        view.mapRaw(p);
+        return view;
+    }
+}
+
+int main()
+{
+    const float inf = std::numeric_limits<float>::infinity();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+
+    // Steps and data must be multiples of the pixel size
+    {
+        std::vector<float> buf(64 * 8);
+        const uchar *base = reinterpret_cast<const uchar *>(buf.data());
+        CHECK(viewStatus(PixelFormat::Raw16, base, 8, 4, 0) == 0);
+        CHECK(viewStatus(PixelFormat::Raw16, base, 8, 4, 18) == 0);
+        CHECK(viewStatus(PixelFormat::Raw16, base, 8, 4, 17) == -1);
+        CHECK(viewStatus(PixelFormat::Raw16, base + 1, 8, 4, 16) == -1);
+        CHECK(viewStatus(PixelFormat::RawF32, base, 8, 4, 0) == 0);
+        CHECK(viewStatus(PixelFormat::RawF32, base, 8, 4, 36) == 0);
+        CHECK(viewStatus(PixelFormat::RawF32, base, 8, 4, 34) == -1);
+        CHECK(viewStatus(PixelFormat::RawF32, base + 2, 8, 4, 32) == -1);
+        // 8-bit formats keep any step
+        CHECK(viewStatus(PixelFormat::BGR, base + 1, 8, 4, 25) == 0);
+
+        // and through the public entry point
+        ImageView img;
+        img.format = PixelFormat::RawF32;
+        img.width = 16;
+        img.height = 16;
+        img.data = base;
+        img.step = 66;
+        const Result R = segmentTempGroups(img, std::nullopt, Params());
+        CHECK(R.status == -1);
+        CHECK(R.stages.empty());
+    }
+
+    // Raw16 counts: temperature = raw * rawGain + rawOffset onto [tempMin, tempMax]
+    {
+        Params p;
+        p.rawGain = 0.04f;
+        p.rawOffset = -273.15f;
+        p.tempMin = -20.f;
+        p.tempMax = 150.f;
+        cv::Mat raw(3, 97, CV_16UC1);
+        for (int y = 0; y < raw.rows; ++y)
+            for (int x = 0; x < raw.cols; ++x)
+                raw.at<uint16_t>(y, x) = (uint16_t)(5000 + 60 * x + 7 * y);   // -73 .. 160 degrees
+        const detail::FrameView view = rawView(raw, p);
+        std::vector<float> row(raw.cols);
+        for (bool clamp : {false, true})
+            for (int y = 0; y < raw.rows; ++y)
+            {
+                const int x0 = y * 5, x1 = raw.cols - y;
+                view.rawScoreRow(y, x0, x1, clamp, row.data());
+                for (int x = x0; x < x1; ++x)
+                {
+                    const double temp = raw.at<uint16_t>(y, x) * (double)p.rawGain + p.rawOffset;
+                    CHECK_NEAR(row[x - x0], expectedScore(temp, p, clamp), 1e-5);
+                }
+            }
+    }
+
+    // RawF32 temperatures, non-finite pixels included
+    {
+        Params p;
+        p.rawGain = 0.5f;
+        p.rawOffset = 10.f;
+        p.tempMin = 0.f;
+        p.tempMax = 80.f;
+        const std::vector<float> vals = {-60.f, -20.f, 0.f, 35.5f, 70.f, 140.f, 200.f, nan, -inf, inf};
+        cv::Mat raw(1, (int)vals.size(), CV_32FC1);
+        std::copy(vals.begin(), vals.end(), raw.ptr<float>(0));
+        const detail::FrameView view = rawView(raw, p);
+        std::vector<float> row(vals.size());
+        for (bool clamp : {false, true})
+        {
+            view.rawScoreRow(0, 0, raw.cols, clamp, row.data());
+            for (size_t i = 0; i < vals.size(); ++i)
+            {
+                CHECK(std::isfinite(row[i]));
+                CHECK_NEAR(row[i], expectedScore(vals[i] * (double)p.rawGain + p.rawOffset, p, clamp), 1e-6);
+            }
+        }
+    }
+
+    // Absolute stages count NaN / -inf pixels at tempMin and +inf at tempMax
+    {
+        Params p;
+        p.tempMin = -20.f;
+        p.tempMax = 150.f;
+        p.tempThresholds = {-20.f, 0.5f, 150.f, 160.f};
+        const int W = 40, H = 32;
+        cv::Mat raw(H, W, CV_32FC1);
+        std::vector<float> temps;
+        for (int i = 0; i < W * H; ++i)
+        {
+            float t = -40.05f + 0.2f * (float)i;            // never on a threshold
+            if (i % 37 == 0)
+                t = nan;
+            else if (i % 41 == 0)
+                t = -inf;
+            else if (i % 43 == 0)
+                t = inf;
+            raw.at<float>(i / W, i % W) = t;
+            temps.push_back(std::isnan(t) || t == -inf ? p.tempMin : (t == inf ? p.tempMax : t));
+        }
+        const Result R = segmentRadiometric(raw, std::nullopt, p);
+        CHECK(R.status == 0);
+        CHECK(R.stages.size() == p.tempThresholds.size());
+        for (size_t k = 0; k < R.stages.size() && k < p.tempThresholds.size(); ++k)
+        {
+            const int sel = (int)std::count_if(temps.begin(), temps.end(),
+                                               [&](float t) { return t >= p.tempThresholds[k]; });
+            CHECK_NEAR(R.stages[k].mortarPermille, 1000.0 * (W * H - sel) / (W * H), 0.005);
+        }
+    }
+
+    return thermal_test::finish("test_radiometric");
+}
@@ -0,0 +1,187 @@
+// Scheduler latest-wins coalescing: a newer submit drops the queued request and
+// abandons the running one, only the latest result per key reaches the
+// callback, and cancel() / wait() / the destructor return with requests in flight.
+// Requests are held in flight by an executor whose parallel regions wait on a gate.
+#include "test_util.hpp"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using namespace thermal;
+
+namespace
+{
+    class GateExecutor : public Executor
+    {
+    public:
+        int concurrency() const override { return 4; }
+        void parallelFor(int count, const std::function<void(int)> &fn) override
+        {
+            {
+                std::unique_lock<std::mutex> lk(mutex_);
+                ++regions_;
+                entered_ = true;
+                cv_.notify_all();
+                cv_.wait(lk, [&] { return open_; });
+            }
+            for (int i = 0; i < count; ++i)
+                fn(i);
+        }
+
+        void close()
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            open_ = false;
+            entered_ = false;
+        }
+        void open()
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            open_ = true;
+            cv_.notify_all();
+        }
+        // Block until a region waits at the closed gate
+        void waitEntered()
+        {
+            std::unique_lock<std::mutex> lk(mutex_);
+            cv_.wait(lk, [&] { return entered_; });
+        }
+        int regions()
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            return regions_;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        bool open_ = true, entered_ = false;
+        int regions_ = 0;
+    };
+
+    // Results per key, as the callbacks saw them
+    struct Delivered
+    {
+        std::mutex mutex;
+        std::map<uint64_t, std::vector<Result>> results;
+
+        ResultCallback to(uint64_t key)
+        {
+            return [this, key](Result &&R)
+            {
+                std::lock_guard<std::mutex> lk(mutex);
+                results[key].push_back(std::move(R));
+            };
+        }
+        size_t count(uint64_t key)
+        {
+            std::lock_guard<std::mutex> lk(mutex);
+            return results[key].size();
+        }
+    };
+
+    Params steps(int n)
+    {
+        Params p;
+        p.stageSteps = n;
+        return p;
+    }
+}
+
+int main()
+{
+    // Large enough for row-stripe regions, which is where the gate holds a request
+    const cv::Mat scene = thermal_test::thermalScene(512, 512, 8);
+    const Polygon roi = thermal_test::testRoi(512, 512);
+    auto gate = std::make_shared<GateExecutor>();
+    setExecutor(gate);
+    const Result ref5 = segmentTempGroups(scene, roi, steps(5));
+    const Result ref6 = segmentTempGroups(scene, std::nullopt, steps(6));
+    const int fullRegions = gate->regions();
+    CHECK(fullRegions >= 4);        // two calls, at least two regions each
+
+    // Newer submits for a running key: abandoned once, then queued replacements dropped
+    {
+        Delivered got;
+        Scheduler sched(1);
+        gate->close();
+        sched.submit(1, scene, roi, steps(3), got.to(1));
+        gate->waitEntered();
+        SchedulerStats st = sched.stats();
+        CHECK(st.submitted == 1 && st.inFlight == 1 && st.queueDepth == 0);
+
+        sched.submit(1, scene, roi, steps(4), got.to(1));
+        st = sched.stats();
+        CHECK(st.abandoned == 1 && st.dropped == 0 && st.queueDepth == 1 && st.inFlight == 1);
+        sched.submit(1, scene, roi, steps(5), got.to(1));
+        sched.submit(2, scene, std::nullopt, steps(6), got.to(2));
+        st = sched.stats();
+        CHECK(st.submitted == 4);
+        CHECK(st.abandoned == 1);   // the running request is abandoned once
+        CHECK(st.dropped == 1);     // steps(4), replaced while queued
+        CHECK(st.queueDepth == 2 && st.inFlight == 1);
+
+        gate->open();
+        sched.wait();
+        st = sched.stats();
+        CHECK(st.completed == 2 && st.queueDepth == 0 && st.inFlight == 0);
+        // superseded results never reach the callback: only the latest per key
+        CHECK(got.count(1) == 1 && got.count(2) == 1);
+        if (got.count(1) == 1 && got.count(2) == 1)
+        {
+            CHECK(thermal_test::sameResult(got.results[1][0], ref5));
+            CHECK(thermal_test::sameResult(got.results[2][0], ref6));
+        }
+    }
+
+    // cancel() returns while the request is held in flight; wait() returns once
+    // it unwound, after fewer regions than a full call, without a callback
+    {
+        Delivered got;
+        Scheduler sched(1);
+        gate->close();
+        sched.submit(3, scene, roi, steps(5), got.to(3));
+        gate->waitEntered();
+        sched.submit(4, scene, roi, steps(5), got.to(4));
+        const int before = gate->regions();
+        sched.cancel(3);
+        sched.cancel(4);
+        SchedulerStats st = sched.stats();
+        CHECK(st.abandoned == 1 && st.dropped == 1 && st.inFlight == 1 && st.queueDepth == 0);
+        gate->open();
+        sched.wait();
+        CHECK(gate->regions() - before < fullRegions / 2);
+        st = sched.stats();
+        CHECK(st.completed == 0 && st.inFlight == 0);
+        CHECK(got.count(3) == 0 && got.count(4) == 0);
+
+        // the scheduler stays usable
+        sched.submit(3, scene, roi, steps(5), got.to(3));
+        sched.wait();
+        CHECK(got.count(3) == 1);
+    }
+
+    // The destructor drops the queue and abandons the request in flight
+    {
+        Delivered got;
+        std::thread opener;
+        {
+            Scheduler sched(2);
+            gate->close();
+            sched.submit(5, scene, roi, steps(5), got.to(5));
+            gate->waitEntered();
+            sched.submit(5, scene, roi, steps(6), got.to(5));
+            opener = std::thread([&]
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                gate->open();
+            });
+        }
+        opener.join();
+        CHECK(got.count(5) == 0);
+    }
+
+    setExecutor(nullptr);
+    return thermal_test::finish("test_scheduler");
+}
@@ -0,0 +1,73 @@
+// Score sources against the ScoreSource::LabExact (cvtColor) path, through the public API
+#include "test_util.hpp"
+
+using namespace thermal;
+
+namespace
+{
+    // Same scene and schedule through source and through LabExact; sort-based CDF so
+    // only the scores differ
+    double selectionDiffVsLab(const cv::Mat &scene, ScoreSource source)
+    {
+        Params p;
+        p.cdfMode = CdfMode::Exact;
+        p.scoreSource = ScoreSource::LabExact;
+        const Result ref = segmentTempGroups(scene, std::nullopt, p);
+        p.scoreSource = source;
+        const Result R = segmentTempGroups(scene, std::nullopt, p);
+        CHECK(ref.status == 0);
+        CHECK(R.status == 0);
+        return thermal_test::maxSelectionDiff(R, ref);
+    }
+}
+
+int main()
+{
+    const cv::Mat scene = thermal_test::thermalScene(320, 240, 1);
+
+    // cvtColor's float Lab carries its own spline error, well above the fused kernel's
+    // 7.7e-6 against exact Lab (test_score_kernels), so this bounds the two together
+    const ScoreError fused = measureScoreError(ScoreSource::Fused);
+    std::printf("fused vs LabExact: max %.3g mean %.3g\n", fused.maxAbs, fused.meanAbs);
+    CHECK(fused.maxAbs <= 2.5e-3f);
+    CHECK(fused.meanAbs <= 1e-3f);
+    CHECK(selectionDiffVsLab(scene, ScoreSource::Fused) <= 1e-3);
+
+    // Table error (3.8e-3 max against exact Lab) on top of cvtColor's
+    const ScoreError lut = measureScoreError(ScoreSource::Lut3D);
+    std::printf("lut3d vs LabExact: max %.3g mean %.3g\n", lut.maxAbs, lut.meanAbs);
+    CHECK(lut.maxAbs <= 6e-3f);
+    CHECK(lut.meanAbs <= 1e-3f);
+    CHECK(selectionDiffVsLab(scene, ScoreSource::Lut3D) <= 5e-3);
+
+    // Palette: iron rendering of a temperature field against LabExact on the gray
+    // rendering of the same field (both scores rise with the temperature). Gray has
+    // only 256 levels, so the two part where a threshold falls inside one gray level
+    // (about 1% of the frame here).
+    const cv::Mat t = thermal_test::temperatureField(320, 240, 2);
+    const cv::Mat iron = thermal_test::renderPalette(t, thermal_test::ironColors());
+    const cv::Mat gray = thermal_test::renderPalette(t, {cv::Vec3b(0, 0, 0), cv::Vec3b(255, 255, 255)});
+    Params p;
+    p.cdfMode = CdfMode::Exact;
+    p.scoreSource = ScoreSource::LabExact;
+    const Result grayRef = segmentTempGroups(gray, std::nullopt, p);
+    p.scoreSource = ScoreSource::Palette;
+    p.palette = Palette::fromColors(thermal_test::ironColors());
+    CHECK(!p.palette.empty());
+    const Result pal = segmentTempGroups(iron, std::nullopt, p);
+    CHECK(grayRef.status == 0);
+    CHECK(pal.status == 0);
+    CHECK(thermal_test::maxSelectionDiff(pal, grayRef) <= 0.02);
+
+    // Gray preset on the gray frame: same order of gray levels as LabExact
+    p.palette = Palette::preset(Palette::Preset::Gray);
+    const Result grayPal = segmentTempGroups(gray, std::nullopt, p);
+    CHECK(grayPal.status == 0);
+    CHECK(thermal_test::maxSelectionDiff(grayPal, grayRef) <= 1e-3);
+
+    // No palette: rejected, not scored
+    p.palette = Palette();
+    CHECK(segmentTempGroups(iron, std::nullopt, p).status == -2);
+
+    return thermal_test::finish("test_score");
+}
@@ -0,0 +1,85 @@
+// Score kernels against a double-precision CIE Lab reference over all 2^24 colors
+#include "test_util.hpp"
+#include "score.hpp"
+
+using namespace thermal::detail;
+
+namespace
+{
+    double labF(double t)
+    {
+        return t > 0.008856 ? std::cbrt(t) : 7.787 * t + 16.0 / 116.0;
+    }
+
+    double srgbLinear(double x)
+    {
+        return x <= 0.04045 ? x / 12.92 : std::pow((x + 0.055) / 1.055, 2.4);
+    }
+
+    // sRGB (D65) -> CIE Lab in double, then the library's score formula
+    float exactScore(int R, int G, int B)
+    {
+        const double r = srgbLinear(R / 255.0), g = srgbLinear(G / 255.0), b = srgbLinear(B / 255.0);
+        const double X = (0.412453 * r + 0.357580 * g + 0.180423 * b) / 0.950456;
+        const double Y = 0.212671 * r + 0.715160 * g + 0.072169 * b;
+        const double Z = (0.019334 * r + 0.119193 * g + 0.950227 * b) / 1.088754;
+        const double L = Y > 0.008856 ? 116.0 * std::cbrt(Y) - 16.0 : 903.3 * Y;
+        return scoreFromLab((float)L, (float)(500.0 * (labF(X) - labF(Y))), (float)(200.0 * (labF(Y) - labF(Z))));
+    }
+
+    struct Err
+    {
+        double maxAbs = 0.0, sum = 0.0;
+        void add(double e)
+        {
+            maxAbs = std::max(maxAbs, e);
+            sum += e;
+        }
+        double mean() const { return sum / (256.0 * 256.0 * 256.0); }
+    };
+}
+
+int main()
+{
+    // One row of 256 blue values per (R, G); the 253 + 3 split runs the vector
+    // body and the scalar tail of the kernels
+    std::vector<uchar> rgba(256 * 4), bgr(256 * 3);
+    std::vector<float> fused(256), lut(256), fusedBgr(256);
+    Err fusedErr, lutErr;
+    int layoutMismatch = 0;
+    for (int R = 0; R < 256; ++R)
+    {
+        for (int G = 0; G < 256; ++G)
+        {
+            for (int B = 0; B < 256; ++B)
+            {
+                uchar *p = &rgba[B * 4];
+                p[0] = (uchar)R, p[1] = (uchar)G, p[2] = (uchar)B, p[3] = 255;
+                uchar *q = &bgr[B * 3];
+                q[0] = (uchar)B, q[1] = (uchar)G, q[2] = (uchar)R;
+            }
+            scoreRow(rgba.data(), PixelLayout::RGBA, fused.data(), 253);
+            scoreRow(rgba.data() + 253 * 4, PixelLayout::RGBA, fused.data() + 253, 3);
+            scoreRowLut3D(rgba.data(), PixelLayout::RGBA, lut.data(), 253);
+            scoreRowLut3D(rgba.data() + 253 * 4, PixelLayout::RGBA, lut.data() + 253, 3);
+            scoreRow(bgr.data(), PixelLayout::BGR, fusedBgr.data(), 256);
+            for (int B = 0; B < 256; ++B)
+            {
+                const float ref = exactScore(R, G, B);
+                fusedErr.add(std::fabs(fused[B] - ref));
+                lutErr.add(std::fabs(lut[B] - ref));
+                layoutMismatch += fusedBgr[B] != fused[B];
+            }
+        }
+    }
+    std::printf("fused max %.3g mean %.3g, lut3d max %.3g mean %.3g\n",
+                fusedErr.maxAbs, fusedErr.mean(), lutErr.maxAbs, lutErr.mean());
+
+    // Documented bounds (score.hpp): fused 7.7e-6 max / 1.2e-7 mean, Lut3D 3.8e-3 max / 2.9e-5 mean
+    CHECK(fusedErr.maxAbs <= 1e-5);
+    CHECK(fusedErr.mean() <= 1e-6);
+    CHECK(lutErr.maxAbs <= 4e-3);
+    CHECK(lutErr.mean() <= 4e-5);
+    CHECK(layoutMismatch == 0);
+    return thermal_test::finish("test_score_kernels");
+}
@@ -0,0 +1,54 @@
+// Session::run against segmentTempGroups with the construction Params,
+// labelIds included
+#include "test_util.hpp"
+
+using namespace thermal;
+
+int main()
+{
+    const cv::Mat scene = thermal_test::thermalScene(320, 240, 4);
+    const Polygon roi = thermal_test::testRoi(320, 240);
+
+    // Analysis variants: default, sort CDF, smoothing, score groups
+    std::vector<Params> variants(4);
+    variants[1].cdfMode = CdfMode::Exact;
+    variants[2].doBilateral = true;
+    variants[3].scoreGroups = true;
+    for (const Params &base : variants)
+    {
+        const Session session(scene, roi, base);
+        CHECK(session.status() == 0);
+
+        // Schedule changes on the same session: first pass, other stage counts, refine
+        Params p = base;
+        CHECK(thermal_test::sameResult(session.run(p), segmentTempGroups(scene, roi, p)));
+        // labelIds from the groups fitted at construction (none without scoreGroups)
+        const Result ids = session.run(p, true);
+        if (base.scoreGroups)
+            CHECK(thermal_test::sameResult(ids, segmentTempGroups(scene, roi, p, true)));
+        CHECK(ids.labelIds.empty() == !base.scoreGroups);
+        p.stageSteps = 9;
+        CHECK(thermal_test::sameResult(session.run(p), segmentTempGroups(scene, roi, p)));
+        p.refineMode = true;
+        p.stageIdx = 4;
+        p.refineSteps = 7;
+        CHECK(thermal_test::sameResult(session.run(p), segmentTempGroups(scene, roi, p)));
+        // statsOnly drops the images, the counts stay those of the rank map
+        const Result withImages = session.run(p);
+        p.statsOnly = true;
+        const Result statsOnly = session.run(p);
+        CHECK(thermal_test::sameResult(statsOnly, withImages, false));
+        CHECK(statsOnly.stages.empty() || !statsOnly.stages[0].hasImage());
+    }
+
+    // The whole frame as ROI
+    const Session whole(scene, std::nullopt, Params());
+    CHECK(thermal_test::sameResult(whole.run(Params()), segmentTempGroups(scene, std::nullopt, Params())));
+
+    // Construction errors surface as status
+    CHECK(Session(cv::Mat(), roi, Params()).status() == -1);
+    Params bad;
+    bad.scoreSource = ScoreSource::Palette;
+    CHECK(Session(scene, roi, bad).status() == -2);
+    return thermal_test::finish("test_session");
+}
@@ -0,0 +1,144 @@
+// StageSink delivery: stages arrive in ascending order, each payload already
+// final (image included) when delivered, before the later stages are computed;
+// returning false ends Result::stages at that stage. Every entry point with a sink.
+#include "test_util.hpp"
+
+using namespace thermal;
+
+namespace
+{
+    struct Delivery
+    {
+        int stage;
+        float thresholdQ, mortarPermille;
+        int labelId;
+        cv::Mat image;      // composited inside the sink
+    };
+
+    // Sink recording every delivery; returns false after stage stopAt (-1 = never)
+    StageSink recorder(std::vector<Delivery> &out, int stopAt = -1)
+    {
+        return [&out, stopAt](int stage, const Payload &pl)
+        {
+            Delivery d{stage, pl.thresholdQ, pl.mortarPermille, pl.labelId, cv::Mat()};
+            if (pl.hasImage())
+                d.image = pl.rgba().clone();
+            out.push_back(d);
+            return stage != stopAt;
+        };
+    }
+
+    // Deliveries match R.stages one to one, in order
+    bool matches(const std::vector<Delivery> &got, const Result &R)
+    {
+        if (got.size() != R.stages.size())
+            return false;
+        for (size_t k = 0; k < got.size(); ++k)
+        {
+            const Payload &pl = R.stages[k];
+            if (got[k].stage != (int)k || got[k].thresholdQ != pl.thresholdQ ||
+                got[k].mortarPermille != pl.mortarPermille || got[k].labelId != pl.labelId)
+                return false;
+            if (pl.hasImage() != !got[k].image.empty())
+                return false;
+            if (pl.hasImage() && cv::norm(got[k].image, pl.rgba(), cv::NORM_INF) != 0.0)
+                return false;
+        }
+        return true;
+    }
+
+    // Same stages (statistics and images) as the first count stages of ref
+    bool prefixOf(const Result &R, const Result &ref, size_t count)
+    {
+        if (R.stages.size() != count || ref.stages.size() < count)
+            return false;
+        for (size_t k = 0; k < count; ++k)
+        {
+            const Payload &a = R.stages[k], &b = ref.stages[k];
+            if (a.thresholdQ != b.thresholdQ || a.mortarPermille != b.mortarPermille || a.labelId != b.labelId)
+                return false;
+            if (a.hasImage() && cv::norm(a.rgba(), b.rgba(), cv::NORM_INF) != 0.0)
+                return false;
+        }
+        return true;
+    }
+}
+
+int main()
+{
+    const int W = 320, H = 240;
+    const cv::Mat scene = thermal_test::thermalScene(W, H, 14);
+    const Polygon roi = thermal_test::testRoi(W, H);
+
+    Params plain, opened, stats;
+    opened.doBilateral = true;      // per-stage opening and count inside the loop
+    stats.statsOnly = true;         // histogram path, no images
+    for (const Params &p : {plain, opened, stats})
+    {
+        // Each entry point with a sink against its own overload without one
+        // (Session's statsOnly counts come from its rank map, not the histogram)
+        struct Call
+        {
+            std::function<Result()> plain;
+            std::function<Result(const StageSink &)> sink;
+        };
+        Engine engine;
+        const Plan plan(scene.size(), roi, p);
+        const Session session(scene, roi, p);
+        const std::vector<Call> calls = {
+            {[&] { return segmentTempGroups(scene, roi, p); },
+             [&](const StageSink &s) { return segmentTempGroups(scene, roi, p, s); }},
+            {[&] { return engine.run(scene, roi, p); },
+             [&](const StageSink &s) { return engine.run(scene, roi, p, s); }},
+            {[&] { return engine.run(plan, scene); },
+             [&](const StageSink &s) { return engine.run(plan, scene, s); }},
+            {[&] { return session.run(p); },
+             [&](const StageSink &s) { return session.run(p, s); }}};
+        for (const Call &call : calls)
+        {
+            const Result ref = call.plain();
+            CHECK(ref.status == 0);
+            CHECK(ref.stages.size() == (size_t)p.stageSteps);
+
+            // every stage, in order, final when delivered
+            std::vector<Delivery> got;
+            const Result R = call.sink(recorder(got));
+            CHECK(R.status == 0);
+            CHECK(matches(got, R));
+            CHECK(prefixOf(R, ref, ref.stages.size()));
+
+            // stop after stage 1: two stages, the same as the full run's
+            got.clear();
+            const Result two = call.sink(recorder(got, 1));
+            CHECK(two.status == 0);
+            CHECK(matches(got, two));
+            CHECK(prefixOf(two, ref, 2));
+
+            // stop at once
+            got.clear();
+            const Result one = call.sink(recorder(got, 0));
+            CHECK(matches(got, one));
+            CHECK(prefixOf(one, ref, 1));
+        }
+    }
+
+    // Delivered before the later stages are computed: a cancel from the first
+    // delivery stops the call before stage 1 is delivered
+    {
+        Params p = opened;
+        auto token = std::make_shared<CancelToken>();
+        p.cancel = token;
+        std::vector<int> delivered;
+        const Result R = segmentTempGroups(scene, roi, p, [&](int stage, const Payload &)
+        {
+            delivered.push_back(stage);
+            token->cancel();
+            return true;
+        });
+        CHECK(R.status == -7);
+        CHECK(R.stages.empty());
+        CHECK(delivered == std::vector<int>{0});
+    }
+
+    return thermal_test::finish("test_sink");
+}
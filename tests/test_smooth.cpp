@@ -0,0 +1,115 @@
+// Fused guided filter against a direct per-window reference, with and without
+// a mask, small to large radii (the block sums of a wide window), and
+// independence from the stripe partition
+#include "test_util.hpp"
+#include "smooth.hpp"
+
+using namespace thermal::detail;
+
+namespace
+{
+    // He et al. guided filter with I = p = score, windows restricted to the mask
+    // (empty = everything), summed pixel by pixel in double
+    cv::Mat guidedRef(const cv::Mat &score, const cv::Mat &mask, int r, float eps, bool clampUnit)
+    {
+        const int H = score.rows, W = score.cols;
+        auto in = [&](int y, int x) { return mask.empty() || mask.at<uchar>(y, x) != 0; };
+        cv::Mat a(score.size(), CV_64F, cv::Scalar(0)), b(score.size(), CV_64F, cv::Scalar(0));
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W; ++x)
+            {
+                if (!in(y, x))
+                    continue;
+                double n = 0, s = 0, ss = 0;
+                for (int yy = std::max(0, y - r); yy <= std::min(H - 1, y + r); ++yy)
+                    for (int xx = std::max(0, x - r); xx <= std::min(W - 1, x + r); ++xx)
+                        if (in(yy, xx))
+                        {
+                            const double v = score.at<float>(yy, xx);
+                            n += 1;
+                            s += v;
+                            ss += v * v;
+                        }
+                const double mean = s / n, var = std::max(ss / n - mean * mean, 0.0);
+                const double ak = var / (var + eps);
+                a.at<double>(y, x) = ak;
+                b.at<double>(y, x) = mean - ak * mean;
+            }
+        cv::Mat out = score.clone();
+        for (int y = 0; y < H; ++y)
+            for (int x = 0; x < W; ++x)
+            {
+                if (!in(y, x))
+                    continue;
+                double n = 0, sa = 0, sb = 0;
+                for (int yy = std::max(0, y - r); yy <= std::min(H - 1, y + r); ++yy)
+                    for (int xx = std::max(0, x - r); xx <= std::min(W - 1, x + r); ++xx)
+                        if (in(yy, xx))
+                        {
+                            n += 1;
+                            sa += a.at<double>(yy, xx);
+                            sb += b.at<double>(yy, xx);
+                        }
+                const double q = (sa * score.at<float>(y, x) + sb) / n;
+                out.at<float>(y, x) = (float)(clampUnit ? std::clamp(q, 0.0, 1.0) : q);
+            }
+        return out;
+    }
+
+    cv::Mat filtered(const cv::Mat &score, const cv::Mat &mask, int r, float eps, int stripeCount, bool clampUnit)
+    {
+        cv::Mat out = score.clone();
+        Stripes st;
+        st.rows = score.rows;
+        st.count = stripeCount;
+        GuidedScratch scratch;
+        guidedFilterMasked(out, mask, r, eps, st, scratch, clampUnit);
+        return out;
+    }
+}
+
+int main()
+{
+    const int W = 131, H = 97;
+    const cv::Mat field = thermal_test::temperatureField(W, H, 4, 0.03f);
+
+    // Polygon-like mask: a slanted edge and a hole
+    cv::Mat mask(H, W, CV_8UC1, cv::Scalar(255));
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x)
+            if (x < y / 3 || (x > 60 && x < 70 && y > 40 && y < 55))
+                mask.at<uchar>(y, x) = 0;
+
+    for (const cv::Mat &m : {cv::Mat(), mask})
+        for (int r : {1, 2, 5, 16})
+        {
+            const cv::Mat ref = guidedRef(field, m, r, 0.0036f, true);
+            const cv::Mat one = filtered(field, m, r, 0.0036f, 1, true);
+            CHECK(cv::norm(one, ref, cv::NORM_INF) <= 2e-5);
+            // any stripe partition gives the same bits
+            for (int n : {2, 3, 7})
+                CHECK(cv::norm(filtered(field, m, r, 0.0036f, n, true), one, cv::NORM_INF) == 0.0);
+            // pixels outside the mask are left alone
+            if (!m.empty())
+                for (int y = 0; y < H; ++y)
+                    for (int x = 0; x < W; ++x)
+                        if (!m.at<uchar>(y, x))
+                            CHECK(one.at<float>(y, x) == field.at<float>(y, x));
+        }
+
+    // Unclamped scores (absolute temperatures) keep their range
+    cv::Mat hot;
+    field.convertTo(hot, CV_32F, 3.0, -1.0);
+    const cv::Mat out = filtered(hot, mask, 2, 0.0036f, 3, false);
+    CHECK(cv::norm(out, guidedRef(hot, mask, 2, 0.0036f, false), cv::NORM_INF) <= 1e-4);
+    double lo = 0, hi = 0;
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < W; ++x)
+        {
+            lo = std::min(lo, (double)out.at<float>(y, x));
+            hi = std::max(hi, (double)out.at<float>(y, x));
+        }
+    CHECK(lo < 0.0 && hi > 1.0);
+
+    return thermal_test::finish("test_smooth");
+}
@@ -0,0 +1,75 @@
+// Stage counts: the stage-index pass against brute force, and the stats-only
+// histogram counts (stageSelectedFromHistogram) against the rank-map path
+#include "test_util.hpp"
+#include "cdf.hpp"
+#include "stages.hpp"
+
+using namespace thermal::detail;
+
+int main()
+{
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    std::normal_distribution<float> n01(0.f, 1.f);
+    const int n = 200000;
+    std::vector<float> scores(n);
+    for (int i = 0; i < n; ++i)
+    {
+        // Broad background, a narrow hot peak and a block of tied values
+        const int kind = i % 5;
+        const float v = kind == 0 ? 0.82f + 0.01f * n01(rng) : (kind == 1 ? 0.4f : 0.2f + 0.5f * u(rng));
+        scores[i] = std::clamp(v, 0.f, 1.f);
+    }
+
+    // Full path: histogram CDF, rank remap, stage-index pass
+    const int bins = 65536;
+    std::vector<uint32_t> hist(bins, 0);
+    for (float s : scores)
+        ++hist[scoreBin(s, bins)];
+    ScoreCdf cdf;
+    buildCdfHistogram(hist, n, cdf);
+    RankLut lut;
+    lut.build(cdf, cdf.maxError);
+    std::vector<float> ranks(n);
+    lut.remapRow(scores.data(), ranks.data(), n);
+
+    // First-pass schedule (6 even quantiles) and a refine window around one stage
+    const std::vector<std::vector<float>> schedules = {
+        {1 / 7.f, 2 / 7.f, 3 / 7.f, 4 / 7.f, 5 / 7.f, 6 / 7.f},
+        {0.37f, 0.38f, 0.4f, 0.41f, 0.43f}};
+    for (const std::vector<float> &T : schedules)
+    {
+        const int nT = (int)T.size();
+        std::vector<uchar> idx(n);
+        std::vector<uint32_t> counts(nT + 1, 0);
+        // Two calls: the pass accumulates counts across spans
+        stageIndexRow(ranks.data(), T.data(), nT, idx.data(), counts.data(), n / 2);
+        stageIndexRow(ranks.data() + n / 2, T.data(), nT, idx.data() + n / 2, counts.data(), n - n / 2);
+        std::vector<int> sel;
+        stageSelectedCounts(counts, sel);
+        CHECK((int)sel.size() == nT);
+
+        std::vector<int> fromHist;
+        stageSelectedFromHistogram(hist, cdf, T, fromHist);
+        CHECK(fromHist.size() == sel.size());
+
+        int idxMismatch = 0;
+        for (int k = 0; k < nT && k < (int)sel.size() && k < (int)fromHist.size(); ++k)
+        {
+            int brute = 0;
+            for (int i = 0; i < n; ++i)
+                brute += ranks[i] >= T[k];
+            CHECK(sel[k] == brute);
+
+            // Documented bound: the population of the bin holding the threshold's score
+            const uint32_t binPop = hist[scoreBin(scoreAtRank(cdf, T[k]), bins)];
+            CHECK_NEAR(fromHist[k], sel[k], binPop + 1);
+        }
+
+        // idx = number of thresholds at or below the rank
+        for (int i = 0; i < n; ++i)
+            idxMismatch += idx[i] != (uchar)std::count_if(T.begin(), T.end(), [&](float t) { return ranks[i] >= t; });
+        CHECK(idxMismatch == 0);
+    }
+    return thermal_test::finish("test_stages");
+}
@@ -0,0 +1,49 @@
+// Params::statsOnly against the full path with images
+#include "test_util.hpp"
+
+using namespace thermal;
+
+namespace
+{
+    Result run(const cv::Mat &scene, const Polygon &roi, Params p, bool statsOnly)
+    {
+        p.statsOnly = statsOnly;
+        const Result R = segmentTempGroups(scene, roi, p);
+        CHECK(R.status == 0);
+        for (const Payload &pl : R.stages)
+            CHECK(pl.hasImage() != statsOnly);
+        return R;
+    }
+}
+
+int main()
+{
+    const cv::Mat scene = thermal_test::thermalScene(320, 240, 3);
+    const Polygon roi = thermal_test::testRoi(320, 240);
+    Params p;
+
+    // Histogram mode counts from the score histogram, splitting the threshold's
+    // bin: off by at most that bin's population, one palette color at most
+    Result full = run(scene, roi, p, false), stats = run(scene, roi, p, true);
+    CHECK(stats.stages.size() == full.stages.size());
+    const double tiePermille = thermal_test::largestTiePermille(scene, roi);
+    CHECK(thermal_test::maxPermilleDiff(stats, full) <= tiePermille);
+    CHECK(stats.cdfError == full.cdfError);
+
+    // Refine schedule: thresholds close together
+    p.refineMode = true;
+    p.stageIdx = 3;
+    full = run(scene, roi, p, false);
+    stats = run(scene, roi, p, true);
+    CHECK(thermal_test::maxPermilleDiff(stats, full) <= tiePermille);
+
+    // Other modes run the full analysis and only skip the images: exact
+    p.refineMode = false;
+    p.cdfMode = CdfMode::Exact;
+    CHECK(thermal_test::sameResult(run(scene, roi, p, true), run(scene, roi, p, false), false));
+    p.cdfMode = CdfMode::Histogram;
+    p.doBilateral = true;
+    CHECK(thermal_test::sameResult(run(scene, roi, p, true), run(scene, roi, p, false), false));
+
+    return thermal_test::finish("test_stats");
+}
@@ -0,0 +1,127 @@
+// Stream::push against segmentTempGroups, and the running-histogram bookkeeping
+#include "test_util.hpp"
+
+using namespace thermal;
+
+namespace
+{
+    // Runs every parallel region inline and cancels the token when region
+    // cancelAt starts: a frame stopped at any point of its pipeline
+    class CancellingExecutor : public Executor
+    {
+    public:
+        explicit CancellingExecutor(std::shared_ptr<CancelToken> token) : token_(std::move(token)) {}
+        int concurrency() const override { return 4; }
+        void parallelFor(int count, const std::function<void(int)> &fn) override
+        {
+            if (++regions == cancelAt)
+                token_->cancel();
+            for (int i = 0; i < count; ++i)
+                fn(i);
+        }
+        int regions = 0, cancelAt = 0;
+
+    private:
+        std::shared_ptr<CancelToken> token_;
+    };
+}
+
+int main()
+{
+    const cv::Mat scene = thermal_test::thermalScene(320, 240, 5);
+    const Polygon roi = thermal_test::testRoi(320, 240);
+    Params p;
+    const Result ref = segmentTempGroups(scene, roi, p);
+    CHECK(ref.status == 0);
+
+    // First frame: the running CDF is the frame's own. Thresholds are applied to
+    // the scores instead of a rank map, which only moves the tie at the boundary.
+    Stream stream(p);
+    const Result first = stream.push(scene, roi);
+    CHECK(first.status == 0);
+    CHECK(stream.rebuilt());
+    CHECK(stream.drift() == 0.f);
+    CHECK(first.stages.size() == ref.stages.size());
+    for (size_t k = 0; k < first.stages.size() && k < ref.stages.size(); ++k)
+        CHECK(first.stages[k].thresholdQ == ref.stages[k].thresholdQ);
+    const double tiePermille = thermal_test::largestTiePermille(scene, roi);
+    CHECK(thermal_test::maxPermilleDiff(first, ref) <= tiePermille);
+    CHECK(thermal_test::maxSelectionDiff(first, ref) <= tiePermille / 1000.0);
+
+    // Same frame again: blended into an identical history, no drift
+    const Result again = stream.push(scene, roi);
+    CHECK(again.status == 0);
+    CHECK(!stream.rebuilt());
+    CHECK(stream.drift() <= 1e-6f);
+    CHECK(thermal_test::maxPermilleDiff(again, first) <= 0.1);
+
+    // Scene change: the history is replaced
+    cv::Mat inverted;
+    cv::subtract(1.0, thermal_test::temperatureField(320, 240, 6), inverted);
+    const cv::Mat other = thermal_test::renderPalette(inverted, thermal_test::ironColors());
+    CHECK(stream.push(other, roi).status == 0);
+    CHECK(stream.rebuilt());
+    CHECK(stream.drift() > 0.05f);
+
+    // A failed frame leaves the running state as it was
+    const float drift = stream.drift();
+    CHECK(stream.push(cv::Mat(), roi).status == -1);
+    CHECK(stream.rebuilt() && stream.drift() == drift);
+
+    // ROI change and reset() both start a new history
+    CHECK(stream.push(other, std::nullopt).status == 0);
+    CHECK(stream.rebuilt());
+    CHECK(stream.push(other, std::nullopt).status == 0);
+    CHECK(!stream.rebuilt());
+    stream.reset();
+    CHECK(stream.push(scene, roi).status == 0);
+    CHECK(stream.rebuilt());
+
+    // First frame with score groups: same stage counts
+    p.scoreGroups = true;
+    Stream grouped(p);
+    const Result g = grouped.push(scene, roi);
+    CHECK(g.status == 0);
+    CHECK(g.usedK >= 1 && g.usedK <= p.maxK);
+    CHECK(thermal_test::maxPermilleDiff(g, first) == 0.0);
+
+    // A frame stopped anywhere, also after its groups were fitted, leaves no
+    // trace: the next frame matches a stream that never saw it (running CDF and
+    // the warm-started group fit alike)
+    const auto token = std::make_shared<CancelToken>();
+    const auto ex = std::make_shared<CancellingExecutor>(token);
+    setExecutor(ex);
+    p.cancel = token;
+    const cv::Mat large = thermal_test::thermalScene(640, 480, 5);
+    const Polygon largeRoi = thermal_test::testRoi(640, 480);
+    cv::Mat largeInverted;
+    cv::subtract(1.0, thermal_test::temperatureField(640, 480, 6), largeInverted);
+    const cv::Mat largeOther = thermal_test::renderPalette(largeInverted, thermal_test::ironColors());
+    Stream clean(p);
+    CHECK(clean.push(large, largeRoi).status == 0);
+    const Result expected = clean.push(large, largeRoi);
+    CHECK(expected.status == 0);
+    int stoppedLast = 0;
+    bool completed = false;
+    for (int at = 1; at < 64; ++at)
+    {
+        Stream s(p);
+        CHECK(s.push(large, largeRoi).status == 0);
+        ex->regions = 0;
+        ex->cancelAt = at;
+        const Result stopped = s.push(largeOther, largeRoi);
+        token->reset();
+        completed = stopped.status == 0; // past the last region
+        if (completed)
+            break;
+        CHECK(stopped.status == -7);
+        stoppedLast = at;
+        ex->cancelAt = 0;
+        CHECK(thermal_test::sameResult(s.push(large, largeRoi), expected));
+        CHECK(!s.rebuilt());
+    }
+    // every region got its stop, the last one being the staging pass
+    CHECK(stoppedLast > 1 && completed);
+    setExecutor(nullptr);
+    return thermal_test::finish("test_stream");
+}
@@ -0,0 +1,268 @@
+// SLIC superpixel stage: grid from regionSize, connected superpixels, one stage per
+// superpixel (from its mean, tMap left alone), labels independent of the score
+// scale and the stripe partition, and the drawEdges outline over the stage images
+#include "test_util.hpp"
+#include "pipeline.hpp"
+#include "payload.hpp"
+
+using namespace thermal;
+using namespace thermal::detail;
+
+namespace
+{
+    const int W = 320, H = 240;
+
+    struct Run
+    {
+        Analysis a;
+        Workspace ws;
+        std::shared_ptr<StageRender> render;
+        Result R;
+        int status = 0;
+    };
+
+    void analyzeScene(Run &run, const cv::Mat &rgba, const Polygon &roi, const Params &p)
+    {
+        Analysis &a = run.a;
+        a.frame = rgba.size();
+        rasterizeRoi(roi, rgba.cols, rgba.rows, a.spans, run.ws.maskBuf);
+        a.stripes = Stripes(a.spans.rect.size(), 1);
+        a.roiRgba = rgba(a.spans.rect).clone();
+        std::string msg;
+        run.status = analyze(FrameView::fromRgba(rgba), p, a, run.ws, msg, false);
+        if (run.status == 0)
+        {
+            stageThresholds(p, run.ws.thresholds);
+            stageResult(a, run.ws.thresholds, p, run.ws, run.render, run.R);
+        }
+    }
+
+    bool inRoi(const RoiSpans &spans, int y, int x)
+    {
+        for (const cv::Vec2i *s = spans.rowBegin(y); s != spans.rowEnd(y); ++s)
+            if (x >= (*s)[0] && x < (*s)[1])
+                return true;
+        return false;
+    }
+
+    // ROI pixels without a superpixel (or one past count), outside pixels with one
+    int badLabels(const Superpixels &sp, const RoiSpans &spans)
+    {
+        int bad = 0;
+        for (int y = 0; y < sp.labels.rows; ++y)
+            for (int x = 0; x < sp.labels.cols; ++x)
+            {
+                const int l = sp.labels.at<int>(y, x);
+                bad += inRoi(spans, y, x) ? l < 0 || l >= sp.count : l != -1;
+            }
+        return bad;
+    }
+
+    // Superpixels in more than one 4-connected piece, or empty by labels but not
+    // by size (or the other way round)
+    int splitSuperpixels(const Superpixels &sp)
+    {
+        const cv::Rect box(0, 0, sp.labels.cols, sp.labels.rows);
+        std::vector<int> pieces(sp.count, 0);
+        cv::Mat seen(box.size(), CV_8UC1, cv::Scalar(0));
+        std::vector<cv::Point> stack;
+        for (int y = 0; y < box.height; ++y)
+            for (int x = 0; x < box.width; ++x)
+            {
+                const int l = sp.labels.at<int>(y, x);
+                if (l < 0 || seen.at<uchar>(y, x))
+                    continue;
+                ++pieces[l];
+                seen.at<uchar>(y, x) = 1;
+                stack.assign(1, cv::Point(x, y));
+                while (!stack.empty())
+                {
+                    const cv::Point q = stack.back();
+                    stack.pop_back();
+                    const cv::Point nb[4] = {{q.x - 1, q.y}, {q.x + 1, q.y}, {q.x, q.y - 1}, {q.x, q.y + 1}};
+                    for (const cv::Point &n : nb)
+                        if (n.inside(box) && !seen.at<uchar>(n) && sp.labels.at<int>(n) == l)
+                        {
+                            seen.at<uchar>(n) = 1;
+                            stack.push_back(n);
+                        }
+                }
+            }
+        int split = 0;
+        for (int i = 0; i < sp.count; ++i)
+            split += pieces[i] > 1 || (pieces[i] == 0) != (sp.size[i] == 0);
+        return split;
+    }
+}
+
+int main()
+{
+    const cv::Mat rgba = thermal_test::thermalScene(W, H, 21);
+    const Polygon roi = thermal_test::testRoi(W, H);
+
+    Params p;
+    p.superpixels = true;
+    p.regionSize = 24;
+    Run run;
+    analyzeScene(run, rgba, roi, p);
+    CHECK(run.status == 0);
+    CHECK(run.R.status == 0);
+    const Superpixels &sp = run.a.superpixels;
+    const cv::Rect rect = run.a.spans.rect;
+
+    // Grid of regionSize cells over the ROI box; every ROI pixel labelled with a
+    // superpixel (seeded in the 3x3 cells around its own, unless its piece was
+    // handed to a neighbour by the connectivity step), outside pixels -1
+    CHECK(sp.cell == p.regionSize);
+    CHECK(sp.gridW == (rect.width + p.regionSize - 1) / p.regionSize);
+    CHECK(sp.gridH == (rect.height + p.regionSize - 1) / p.regionSize);
+    CHECK(sp.count >= sp.gridW * sp.gridH);
+    int sizeSum = 0, nonEmpty = 0;
+    for (int i = 0; i < sp.count; ++i)
+    {
+        sizeSum += sp.size[i];
+        nonEmpty += sp.size[i] > 0;
+    }
+    CHECK(sizeSum == (int)run.a.spans.pixels);
+    CHECK(nonEmpty > sp.count / 2);
+    CHECK(badLabels(sp, run.a.spans) == 0);
+    // Connectivity: every non-empty superpixel is one 4-connected piece
+    CHECK(splitSuperpixels(sp) == 0);
+
+    // Concave and multi-part ROIs (two boxes joined by a thin neck, a bowtie, two
+    // boxes joined by a diagonal line of single pixels): still one piece per
+    // superpixel, pieces touching no other superpixel become superpixels of their
+    // own, and the stripe partition does not matter
+    {
+        Polygon neck, bowtie, linked;
+        neck.xs = {40, 110, 110, 200, 200, 280, 280, 200, 200, 110, 110, 40};
+        neck.ys = {60, 60, 118, 118, 40, 40, 200, 200, 121, 121, 180, 180};
+        bowtie.xs = {30, 290, 290, 30};
+        bowtie.ys = {30, 210, 30, 210};
+        linked.xs = {20, 70, 70, 20, 20, 250, 300, 300, 250, 250};
+        linked.ys = {20, 20, 70, 70, 20, 170, 170, 220, 220, 170};
+        for (const Polygon &shape : {neck, bowtie, linked})
+        {
+            Run lobes;
+            analyzeScene(lobes, rgba, shape, p);
+            CHECK(lobes.status == 0 && lobes.R.status == 0);
+            const Superpixels &ls = lobes.a.superpixels;
+            CHECK(ls.count >= ls.gridW * ls.gridH);
+            CHECK(badLabels(ls, lobes.a.spans) == 0);
+            CHECK(splitSuperpixels(ls) == 0);
+            int sum = 0;
+            for (int i = 0; i < ls.count; ++i)
+                sum += ls.size[i];
+            CHECK(sum == (int)lobes.a.spans.pixels);
+            Stripes st = lobes.a.stripes;
+            st.count = 3;
+            Superpixels other;
+            buildSuperpixels(lobes.a.tMap, lobes.a.spans, st, p.regionSize, p.compactness, other, lobes.ws);
+            CHECK(other.count == ls.count);
+            CHECK(cv::norm(other.labels, ls.labels, cv::NORM_INF) == 0.0);
+        }
+    }
+
+    // tMap keeps the per-pixel ranks: same as without superpixels
+    {
+        Params off = p;
+        off.superpixels = false;
+        Run plain;
+        analyzeScene(plain, rgba, roi, off);
+        CHECK(plain.status == 0);
+        CHECK(cv::norm(plain.a.tMap, run.a.tMap, cv::NORM_INF) == 0.0);
+    }
+
+    // Every pixel of a superpixel lands in its mean's stage; counts follow
+    {
+        const std::vector<float> &T = run.ws.thresholds;
+        const cv::Mat &stageMap = run.render->stageMap;
+        int mismatch = 0;
+        for (int y = 0; y < rect.height; ++y)
+            for (int x = 0; x < rect.width; ++x)
+            {
+                const int l = sp.labels.at<int>(y, x);
+                if (l < 0)
+                    continue;
+                const int k = (int)(std::upper_bound(T.begin(), T.end(), sp.value[l]) - T.begin());
+                mismatch += stageMap.at<uchar>(y, x) != k;
+            }
+        CHECK(mismatch == 0);
+        CHECK(run.R.stages.size() == T.size());
+        for (size_t k = 0; k < run.R.stages.size(); ++k)
+        {
+            int sel = 0;
+            for (int i = 0; i < sp.count; ++i)
+                if (sp.size[i] > 0 && sp.value[i] >= T[k])
+                    sel += sp.size[i];
+            const double total = (double)run.a.spans.pixels;
+            CHECK_NEAR(run.R.stages[k].mortarPermille, 1000.0 * (total - sel) / total, 0.005);
+        }
+    }
+
+    // The value distance is relative to the ROI's score range: an affine rescale of
+    // the map, or another stripe partition, gives the same superpixels
+    {
+        cv::Mat scaled;
+        run.a.tMap.convertTo(scaled, CV_32F, 40.0, -7.0);
+        for (int stripes : {1, 3})
+        {
+            Stripes st = run.a.stripes;
+            st.count = stripes;
+            Superpixels other;
+            buildSuperpixels(stripes == 1 ? scaled : run.a.tMap, run.a.spans, st, p.regionSize, p.compactness,
+                             other, run.ws);
+            int differ = 0;
+            for (int y = 0; y < rect.height; ++y)
+                for (int x = 0; x < rect.width; ++x)
+                    differ += other.labels.at<int>(y, x) != sp.labels.at<int>(y, x);
+            if (stripes == 1)
+                CHECK(differ <= run.a.spans.pixels / 1000);     // fixed-point rounding of the means
+            else
+                CHECK(differ == 0);
+        }
+    }
+
+    // drawEdges: the outline over every stage image, the rest unchanged
+    {
+        Params edges = p;
+        edges.drawEdges = true;
+        Run outlined;
+        analyzeScene(outlined, rgba, roi, edges);
+        CHECK(outlined.R.status == 0);
+        const cv::Mat &E = outlined.render->edges;
+        CHECK(!E.empty() && E.size() == rect.size());
+        CHECK(run.render->edges.empty());
+        const cv::Vec4b outline(255, 255, 0, 255);
+        for (size_t k = 0; k < outlined.R.stages.size() && k < run.R.stages.size(); ++k)
+        {
+            const cv::Mat &with = outlined.R.stages[k].rgba(), &without = run.R.stages[k].rgba();
+            int edgePixels = 0, wrong = 0;
+            for (int y = 0; y < H; ++y)
+                for (int x = 0; x < W; ++x)
+                {
+                    const bool inRect = rect.contains(cv::Point(x, y));
+                    const bool edge = inRect && E.at<uchar>(y - rect.y, x - rect.x) != 0;
+                    edgePixels += edge;
+                    wrong += edge ? with.at<cv::Vec4b>(y, x) != outline
+                                  : with.at<cv::Vec4b>(y, x) != without.at<cv::Vec4b>(y, x);
+                }
+            CHECK(edgePixels > 0);
+            CHECK(wrong == 0);
+        }
+        // outline pixels are exactly the superpixel borders inside the ROI
+        int badEdge = 0;
+        for (int y = 0; y < rect.height; ++y)
+            for (int x = 0; x < rect.width; ++x)
+            {
+                const int l = sp.labels.at<int>(y, x);
+                const int r = x + 1 < rect.width ? sp.labels.at<int>(y, x + 1) : -1;
+                const int d = y + 1 < rect.height ? sp.labels.at<int>(y + 1, x) : -1;
+                const bool border = l >= 0 && ((r >= 0 && r != l) || (d >= 0 && d != l));
+                badEdge += border != (E.at<uchar>(y, x) != 0);
+            }
+        CHECK(badEdge == 0);
+    }
+
+    return thermal_test::finish("test_superpixel");
+}
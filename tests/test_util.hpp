@@ -0,0 +1,230 @@
+#pragma once
+// Shared helpers of the unit tests: CHECK macros and synthetic thermal scenes.
+// No test framework; each test is an executable that ctest runs, exit code 0 = pass.
+#include "thermal/core.hpp"
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace thermal_test
+{
+    inline int &failures()
+    {
+        static int n = 0;
+        return n;
+    }
+
+#define CHECK(cond)                                                                   \
+    do                                                                                \
+    {                                                                                 \
+        if (!(cond))                                                                  \
+        {                                                                             \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++thermal_test::failures();                                               \
+        }                                                                             \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tol)                                                         \
+    do                                                                                \
+    {                                                                                 \
+        const double a_ = (double)(a), b_ = (double)(b);                              \
+        if (!(std::fabs(a_ - b_) <= (double)(tol)))                                   \
+        {                                                                             \
+            std::fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s, %s) failed: %g vs %g\n",  \
+                         __FILE__, __LINE__, #a, #b, #tol, a_, b_);                   \
+            ++thermal_test::failures();                                               \
+        }                                                                             \
+    } while (0)
+
+    // Exit code of main: prints the verdict
+    inline int finish(const char *name)
+    {
+        if (failures() == 0)
+            std::printf("%s: ok\n", name);
+        else
+            std::printf("%s: %d check(s) failed\n", name, failures());
+        return failures() == 0 ? 0 : 1;
+    }
+
+    // Iron-like colormap, cold to hot
+    inline const std::vector<cv::Vec3b> &ironColors()
+    {
+        static const std::vector<cv::Vec3b> colors = {
+            {0, 0, 0}, {32, 0, 140}, {150, 0, 160}, {220, 40, 60},
+            {250, 140, 0}, {255, 220, 40}, {255, 255, 255}};
+        return colors;
+    }
+
+    // CV_32F temperature field in [0.02, 1]: gradient, two hot spots, a cold block and
+    // noise. Kept off 0 so that no rendered pixel is black (see selection).
+    inline cv::Mat temperatureField(int w, int h, unsigned seed, float noise = 0.02f)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> n01(0.f, 1.f);
+        std::uniform_real_distribution<float> u(0.2f, 0.8f);
+        const float hx[2] = {u(rng) * w, u(rng) * w}, hy[2] = {u(rng) * h, u(rng) * h};
+        const float hr = 0.12f * std::min(w, h);
+        cv::Mat t(h, w, CV_32F);
+        for (int y = 0; y < h; ++y)
+        {
+            float *row = t.ptr<float>(y);
+            for (int x = 0; x < w; ++x)
+            {
+                float v = 0.15f + 0.35f * (float)y / (float)h;
+                for (int k = 0; k < 2; ++k)
+                {
+                    const float dx = (x - hx[k]) / hr, dy = (y - hy[k]) / hr;
+                    v += (0.45f - 0.1f * k) * std::exp(-(dx * dx + dy * dy));
+                }
+                if (x > w / 10 && x < w / 4 && y > h / 2 && y < h * 3 / 4)
+                    v -= 0.1f;
+                row[x] = std::clamp(v + noise * n01(rng), 0.02f, 1.f);
+            }
+        }
+        return t;
+    }
+
+    // CV_8UC4 RGBA rendering of t through colors (linear in between)
+    inline cv::Mat renderPalette(const cv::Mat &t, const std::vector<cv::Vec3b> &colors)
+    {
+        const int segs = (int)colors.size() - 1;
+        cv::Mat rgba(t.size(), CV_8UC4);
+        for (int y = 0; y < t.rows; ++y)
+        {
+            const float *src = t.ptr<float>(y);
+            cv::Vec4b *dst = rgba.ptr<cv::Vec4b>(y);
+            for (int x = 0; x < t.cols; ++x)
+            {
+                const float pos = std::clamp(src[x], 0.f, 1.f) * segs;
+                const int i = std::min((int)pos, segs - 1);
+                const float f = pos - (float)i;
+                for (int c = 0; c < 3; ++c)
+                    dst[x][c] = cv::saturate_cast<uchar>(colors[i][c] + f * (colors[i + 1][c] - colors[i][c]));
+                dst[x][3] = 255;
+            }
+        }
+        return rgba;
+    }
+
+    // Iron-palette pseudo-color frame (CV_8UC4 RGBA)
+    inline cv::Mat thermalScene(int w, int h, unsigned seed = 1)
+    {
+        return renderPalette(temperatureField(w, h, seed), ironColors());
+    }
+
+    // Quadrilateral ROI well inside a w x h frame (not axis-aligned, so spans vary per row)
+    inline thermal::Polygon testRoi(int w, int h)
+    {
+        thermal::Polygon roi;
+        roi.xs = {w / 10, w * 8 / 10, w * 9 / 10, w / 5};
+        roi.ys = {h / 8, h / 10, h * 9 / 10, h * 8 / 10};
+        return roi;
+    }
+
+    // Largest share of the ROI (permille) sharing one color. Equal colors score
+    // equal, so this is the largest tie a threshold can fall into: paths that break
+    // ties differently (rank map, score threshold, split histogram bin) differ by at most this much.
+    inline double largestTiePermille(const cv::Mat &rgba, const thermal::Polygon &roi)
+    {
+        std::vector<cv::Point> pts;
+        for (size_t i = 0; i < roi.xs.size(); ++i)
+            pts.emplace_back(roi.xs[i], roi.ys[i]);
+        cv::Mat mask(rgba.size(), CV_8UC1, cv::Scalar(0));
+        const cv::Point *pp = pts.data();
+        const int n = (int)pts.size();
+        cv::fillPoly(mask, &pp, &n, 1, cv::Scalar(255));
+        std::unordered_map<uint32_t, int> counts;
+        int largest = 0, total = 0;
+        for (int y = 0; y < rgba.rows; ++y)
+            for (int x = 0; x < rgba.cols; ++x)
+                if (mask.at<uchar>(y, x))
+                {
+                    ++total;
+                    largest = std::max(largest, ++counts[rgba.at<uint32_t>(y, x)]);
+                }
+        return total > 0 ? 1000.0 * largest / total : 0.0;
+    }
+
+    // Same status, groups and per-stage statistics; images identical pixel for pixel if images
+    inline bool sameResult(const thermal::Result &a, const thermal::Result &b, bool images = true)
+    {
+        if (a.status != b.status || a.usedK != b.usedK || a.stages.size() != b.stages.size() || a.labelIds != b.labelIds)
+        {
+            std::fprintf(stderr, "  status %d/%d, usedK %d/%d, stages %zu/%zu, labelIds %zu/%zu\n",
+                         a.status, b.status, a.usedK, b.usedK, a.stages.size(), b.stages.size(),
+                         a.labelIds.size(), b.labelIds.size());
+            return false;
+        }
+        for (size_t k = 0; k < a.stages.size(); ++k)
+        {
+            const thermal::Payload &pa = a.stages[k], &pb = b.stages[k];
+            if (pa.mortarPermille != pb.mortarPermille || pa.labelId != pb.labelId || pa.thresholdQ != pb.thresholdQ)
+            {
+                std::fprintf(stderr, "  stage %zu: permille %g/%g, labelId %d/%d, thresholdQ %g/%g\n", k,
+                             pa.mortarPermille, pb.mortarPermille, pa.labelId, pb.labelId, pa.thresholdQ, pb.thresholdQ);
+                return false;
+            }
+            if (!images)
+                continue;
+            if (pa.hasImage() != pb.hasImage() ||
+                (pa.hasImage() && (pa.size() != pb.size() || cv::norm(pa.rgba(), pb.rgba(), cv::NORM_INF) != 0)))
+            {
+                std::fprintf(stderr, "  stage %zu: images differ\n", k);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Pixels a stage selects (1) in scanline order: its image shows the input there
+    // and black elsewhere, so the input must have no black pixels
+    inline std::vector<uchar> selection(const thermal::Payload &pl)
+    {
+        const cv::Mat &img = pl.rgba();
+        std::vector<uchar> sel;
+        sel.reserve((size_t)img.rows * img.cols);
+        for (int y = 0; y < img.rows; ++y)
+        {
+            const cv::Vec4b *row = img.ptr<cv::Vec4b>(y);
+            for (int x = 0; x < img.cols; ++x)
+                sel.push_back(row[x][0] || row[x][1] || row[x][2]);
+        }
+        return sel;
+    }
+
+    // Largest share of the frame that the same stage of a and b selects differently
+    inline double maxSelectionDiff(const thermal::Result &a, const thermal::Result &b)
+    {
+        if (a.stages.size() != b.stages.size() || a.stages.empty())
+            return HUGE_VAL;
+        double worst = 0.0;
+        for (size_t k = 0; k < a.stages.size(); ++k)
+        {
+            const std::vector<uchar> sa = selection(a.stages[k]), sb = selection(b.stages[k]);
+            if (sa.size() != sb.size() || sa.empty())
+                return HUGE_VAL;
+            size_t diff = 0;
+            for (size_t i = 0; i < sa.size(); ++i)
+                diff += sa[i] != sb[i];
+            worst = std::max(worst, (double)diff / (double)sa.size());
+        }
+        return worst;
+    }
+
+    // Largest per-stage |mortarPermille| difference (stage counts must match)
+    inline double maxPermilleDiff(const thermal::Result &a, const thermal::Result &b)
+    {
+        if (a.stages.size() != b.stages.size())
+            return HUGE_VAL;
+        double d = 0.0;
+        for (size_t k = 0; k < a.stages.size(); ++k)
+            d = std::max(d, (double)std::fabs(a.stages[k].mortarPermille - b.stages[k].mortarPermille));
+        return d;
+    }
+
+} // namespace thermal_test